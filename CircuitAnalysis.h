@@ -0,0 +1,100 @@
+#ifndef CIRCUIT_ANALYSIS_H
+#define CIRCUIT_ANALYSIS_H
+
+#include <vector>
+#include <string>
+#include <iostream>
+#include "CircuitSolver.h"
+#include "SparseSolver.h"
+
+using namespace std;
+
+
+// 1. Cost Model (memory and time predictions per solver backend)
+
+
+// Helpers: human-readable units for reports and error messages
+string formatBytes(double bytes);
+string formatSeconds(double seconds);
+
+// Parse sizes like "512M" or "2G" (binary units, as used by --max-memory)
+bool parseByteSize(const string& text, size_t& bytes);
+
+struct BackendEstimate {
+    string name;
+    double memoryBytes = 0; // Peak working set of the solve
+    double seconds = 0;     // Predicted wall time on this machine
+    string note;
+};
+
+// Sustained dense floating-point rate of this machine (measured once, cached)
+double machineFlopRate();
+
+// Dense MNA path: gaussianElimination() on a matrixSize x matrixSize system
+BackendEstimate estimateDense(int matrixSize);
+
+// Sparse Cholesky on the reduced nodal system (exact sizes from the
+// supernodal structure, which is cheap to build)
+BackendEstimate estimateSparseDirect(const SparseMatrix& A, const SupernodalStructure& S);
+
+// Same factorization with the panels spilled to disk: only the frontal
+// matrix, the update stack and two I/O blocks stay in memory
+BackendEstimate estimateOutOfCore(const SparseMatrix& A, const SupernodalStructure& S,
+                                  size_t blockBytes = SparseCholesky::DEFAULT_IO_BLOCK_BYTES);
+
+// Largest I/O block (up to the default, at least 1 MB) that keeps the
+// out-of-core estimate within budgetBytes
+size_t outOfCoreBlockBytes(const SparseMatrix& A, const SupernodalStructure& S, size_t budgetBytes);
+
+// Jacobi-preconditioned CG; the iteration count is predicted from the
+// graph diameter, which bounds how far information must travel
+BackendEstimate estimateIterative(const SparseMatrix& A, int diameter, double tolerance = 1e-10);
+
+
+// 2. Topology Statistics
+
+
+struct OrderingReport {
+    string name;
+    int bandwidth = 0;
+    long long nnzL = 0;
+    double flops = 0;
+    int maxFront = 0;
+    double orderingSeconds = 0; // Time spent computing the ordering itself
+};
+
+struct CircuitAnalysis {
+    // Counts
+    int nodes = 0; // Excluding ground
+    int resistors = 0;
+    int currentSources = 0;
+    int voltageSources = 0;
+
+    // Degree distribution (distinct neighbouring nodes, ground excluded)
+    int groundDegree = 0;
+    int minDegree = 0;
+    int maxDegree = 0;
+    double meanDegree = 0;
+    vector<pair<string, int>> degreeHistogram;
+
+    // Connectivity
+    int connectedComponents = 0;
+    int floatingComponents = 0; // Components with no path to ground
+
+    // Linear systems
+    int mnaSize = 0;          // Dense MNA matrix dimension
+    int reducedUnknowns = 0;  // Reduced nodal (SPD) system dimension
+    long long reducedNnz = 0;
+    int diameter = 0;
+
+    vector<OrderingReport> orderings;
+    vector<BackendEstimate> backends;
+    string error; // Set when the reduced system cannot be formed
+};
+
+// Analyze the circuit without factoring anything
+CircuitAnalysis analyzeCircuit(const Circuit& circuit);
+
+void printAnalysis(const CircuitAnalysis& report, ostream& out);
+
+#endif // CIRCUIT_ANALYSIS_H
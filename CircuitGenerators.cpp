@@ -0,0 +1,148 @@
+#include "CircuitGenerators.h"
+#include <random>
+#include <cmath>
+#include <functional>
+#include <algorithm>
+
+const long long GROUND = -1; // Node index used for ground while generating
+
+
+// Helper: Family Names
+
+const char* familyName(CircuitFamily family) {
+    switch (family) {
+        case FAMILY_LADDER: return "ladder";
+        case FAMILY_GRID_2D: return "grid2d";
+        case FAMILY_GRID_3D: return "grid3d";
+        case FAMILY_RANDOM: return "random";
+        case FAMILY_TREE: return "tree";
+        case FAMILY_STAR: return "star";
+        case FAMILY_VOLTAGE_SOURCES: return "vsources";
+    }
+    return "unknown";
+}
+
+vector<CircuitFamily> allFamilies() {
+    return {FAMILY_LADDER, FAMILY_GRID_2D, FAMILY_GRID_3D, FAMILY_RANDOM,
+            FAMILY_TREE, FAMILY_STAR, FAMILY_VOLTAGE_SOURCES};
+}
+
+bool parseFamily(const string& name, CircuitFamily& family) {
+    for (CircuitFamily f : allFamilies()) {
+        if (name == familyName(f)) { family = f; return true; }
+    }
+    return false;
+}
+
+
+// Helper: emit the components of a family through a callback
+// (type 'R', 'I' or 'V', node indices with GROUND = -1, value)
+
+typedef function<void(char, long long, long long, double)> ComponentSink;
+
+static void generate(CircuitFamily family, long long nodes, unsigned seed, const ComponentSink& emit) {
+    if (nodes < 2) nodes = 2;
+    mt19937_64 rng(seed);
+    uniform_real_distribution<double> resistance(1.0, 100.0);
+    auto pick = [&](long long n) { return (long long)(rng() % (unsigned long long)n); };
+
+    switch (family) {
+    case FAMILY_LADDER:
+        emit('V', 0, GROUND, 10.0);
+        for (long long i = 0; i < nodes; i++) {
+            if (i + 1 < nodes) emit('R', i, i + 1, 1000.0);
+            emit('R', i, GROUND, 2000.0);
+        }
+        break;
+
+    case FAMILY_GRID_2D:
+    case FAMILY_GRID_3D: {
+        int dims = family == FAMILY_GRID_2D ? 2 : 3;
+        long long side = max(2LL, (long long)llround(pow((double)nodes, 1.0 / dims)));
+        long long planes = dims == 3 ? side : 1;
+        auto id = [&](long long x, long long y, long long z) { return (z * side + y) * side + x; };
+        for (long long z = 0; z < planes; z++) {
+            for (long long y = 0; y < side; y++) {
+                for (long long x = 0; x < side; x++) {
+                    if (x + 1 < side) emit('R', id(x, y, z), id(x + 1, y, z), resistance(rng));
+                    if (y + 1 < side) emit('R', id(x, y, z), id(x, y + 1, z), resistance(rng));
+                    if (z + 1 < planes) emit('R', id(x, y, z), id(x, y, z + 1), resistance(rng));
+                }
+            }
+        }
+        long long total = side * side * planes;
+        emit('V', 0, GROUND, 5.0);
+        emit('R', total - 1, GROUND, 10.0);
+        for (long long k = 0; k < max(1LL, total / 100); k++) emit('I', GROUND, pick(total), 0.01);
+        break;
+    }
+
+    case FAMILY_RANDOM: {
+        // Random spanning tree first so the graph is connected
+        vector<long long> order(nodes);
+        for (long long i = 0; i < nodes; i++) order[i] = i;
+        shuffle(order.begin(), order.end(), rng);
+        for (long long i = 1; i < nodes; i++) emit('R', order[pick(i)], order[i], resistance(rng));
+        for (long long k = 0; k < 2 * nodes; k++) {
+            long long a = pick(nodes), b = pick(nodes);
+            if (a != b) emit('R', a, b, resistance(rng));
+        }
+        emit('V', order[0], GROUND, 5.0);
+        for (long long k = 0; k < max(1LL, nodes / 20); k++) emit('R', pick(nodes), GROUND, 1000.0);
+        for (long long k = 0; k < max(1LL, nodes / 50); k++) emit('I', GROUND, pick(nodes), 0.001);
+        break;
+    }
+
+    case FAMILY_TREE:
+        emit('V', 0, GROUND, 12.0);
+        for (long long i = 1; i < nodes; i++) emit('R', pick(i), i, resistance(rng));
+        for (long long k = 0; k < max(1LL, nodes / 10); k++) emit('I', pick(nodes), GROUND, 0.001);
+        break;
+
+    case FAMILY_STAR:
+        for (long long i = 0; i < nodes; i++) {
+            emit('R', i, GROUND, resistance(rng));
+            if (i % 4 != 0) emit('R', i - 1, i, resistance(rng));
+        }
+        for (long long k = 0; k < max(1LL, nodes / 10); k++) emit('I', GROUND, pick(nodes), 0.01);
+        break;
+
+    case FAMILY_VOLTAGE_SOURCES:
+        // A path, so the sources can never form a loop
+        for (long long i = 0; i + 1 < nodes; i++) {
+            if (i % 2 == 0) emit('V', i + 1, i, 1.0);
+            else emit('R', i, i + 1, resistance(rng));
+        }
+        for (long long i = 0; i < nodes; i += 2) emit('R', i, GROUND, 1000.0);
+        break;
+    }
+}
+
+static string nodeLabel(long long node) {
+    return node == GROUND ? string("GND") : "n" + to_string(node);
+}
+
+
+// writeCircuit() / buildCircuit() Implementation
+
+long long writeCircuit(CircuitFamily family, long long nodes, unsigned seed, ostream& out) {
+    long long count = 0;
+    streamsize oldPrecision = out.precision(17); // Round-trips every value exactly
+    generate(family, nodes, seed, [&](char type, long long a, long long b, double value) {
+        count++;
+        out << type << " " << type << count << " " << nodeLabel(a) << " " << nodeLabel(b) << " " << value << "\n";
+    });
+    out.precision(oldPrecision);
+    return count;
+}
+
+void buildCircuit(CircuitFamily family, long long nodes, unsigned seed, Circuit& circuit) {
+    circuit.clearCircuit();
+    long long count = 0;
+    generate(family, nodes, seed, [&](char type, long long a, long long b, double value) {
+        string name = string(1, type) + to_string(++count);
+        if (type == 'R') circuit.addResistor(name, nodeLabel(a), nodeLabel(b), value);
+        else if (type == 'I') circuit.addCurrentSource(name, nodeLabel(a), nodeLabel(b), value);
+        else circuit.addVoltageSource(name, nodeLabel(a), nodeLabel(b), value);
+    });
+}
@@ -0,0 +1,45 @@
+#ifndef CIRCUIT_GENERATORS_H
+#define CIRCUIT_GENERATORS_H
+
+#include <vector>
+#include <string>
+#include <iostream>
+#include "CircuitSolver.h"
+
+using namespace std;
+
+
+// 1. Synthetic Circuit Families
+
+
+// Every family is connected and has a resistive path to ground from every
+// node, so all of them are solvable by every backend.
+enum CircuitFamily {
+    FAMILY_LADDER,          // R-2R ladder driven by one voltage source
+    FAMILY_GRID_2D,         // Square resistor mesh
+    FAMILY_GRID_3D,         // Cubic resistor mesh
+    FAMILY_RANDOM,          // Random spanning tree plus random extra edges
+    FAMILY_TREE,            // Random tree hanging off one voltage source
+    FAMILY_STAR,            // Every node tied to ground (huge ground degree)
+    FAMILY_VOLTAGE_SOURCES  // Chain alternating voltage sources and resistors
+};
+
+const char* familyName(CircuitFamily family);
+bool parseFamily(const string& name, CircuitFamily& family);
+vector<CircuitFamily> allFamilies();
+
+
+// 2. Generators
+
+
+// Same family, size and seed always give the same circuit. 'nodes' is a
+// target: meshes round it to a whole side length.
+
+// Write a netlist in the format read by Circuit::loadCircuit(); returns the
+// number of components written
+long long writeCircuit(CircuitFamily family, long long nodes, unsigned seed, ostream& out);
+
+// Add the same components straight to a circuit (which is cleared first)
+void buildCircuit(CircuitFamily family, long long nodes, unsigned seed, Circuit& circuit);
+
+#endif // CIRCUIT_GENERATORS_H
@@ -1,4 +1,7 @@
 #include "CircuitSolver.h"
+#include "SparseSolver.h"
+#include "CircuitAnalysis.h"
+#include "ResultCache.h"
 #include <iostream>
 #include <vector>
 #include <cmath>
@@ -7,6 +10,10 @@
 #include <iomanip>
 #include <stdexcept>
 #include <algorithm> 
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <cstdio>
 
 using namespace std;
 
@@ -33,10 +40,13 @@ bool compareNodes(const pair<string, int>& a, const pair<string, int>& b) {
 
 // Helper: Robust Gaussian Elimination
 
-vector<double> gaussianElimination(vector<vector<double>> A, vector<double> B) {
+const char* const CANCELLED_MESSAGE = "Solve cancelled.";
+
+vector<double> gaussianElimination(vector<vector<double>> A, vector<double> B,
+                                   const FactorizationCallback& keepGoing) {
     int n = A.size();
     const double EPSILON = 1e-9;
-    
+
     for (int i = 0; i < n; i++) {
         double maxEl = abs(A[i][i]);
         int maxRow = i;
@@ -60,6 +70,11 @@ vector<double> gaussianElimination(vector<vector<double>> A, vector<double> B) {
                 A[k][j] -= factor * A[i][j];
             }
         }
+        // Work left after row i shrinks with the cube of the remaining size
+        if (keepGoing) {
+            double left = (double)(n - 1 - i) / n;
+            if (!keepGoing(1.0 - left * left * left)) throw runtime_error(CANCELLED_MESSAGE);
+        }
     }
 
     vector<double> x(n);
@@ -74,129 +89,761 @@ vector<double> gaussianElimination(vector<vector<double>> A, vector<double> B) {
 }
 
 
+// Helper: Dense MNA Assembly (node rows first, then one row per voltage source)
+
+void assembleMNA(const Circuit& circuit, vector<vector<double>>& A, vector<double>& B) {
+    int nodeCount = circuit.getNodeCount();
+    int vSourceCount = 0;
+    for (const auto& comp : circuit.getComponents()) if (comp->getType() == VOLTAGE_SOURCE) vSourceCount++;
+    int matrixSize = nodeCount + vSourceCount;
+    A.assign(matrixSize, vector<double>(matrixSize, 0.0));
+    B.assign(matrixSize, 0.0);
+    stampMNA(circuit, A, B);
+}
+
+
+// Fixed-size Dense Solve - One Kernel per Size, Chosen at Run Time
+
+template<size_t N>
+static void solveFixedSize(const Circuit& circuit, vector<double>& voltages) {
+    array<array<double, N>, N> A{};
+    array<double, N> B{};
+    stampMNA(circuit, A, B);
+    array<double, N> x = fixedGaussianElimination<N>(A, B);
+    for (int i = 0; i < circuit.getNodeCount(); i++) voltages[i + 1] = x[i];
+}
+
+typedef void (*FixedSizeSolver)(const Circuit&, vector<double>&);
+
+template<size_t... I>
+static constexpr array<FixedSizeSolver, sizeof...(I)> fixedSizeSolvers(index_sequence<I...>) {
+    return {{solveFixedSize<I + 1>...}};
+}
+
+void solveFixedMNA(const Circuit& circuit, int matrixSize, vector<double>& voltages) {
+    static constexpr array<FixedSizeSolver, FIXED_SIZE_LIMIT> solvers =
+        fixedSizeSolvers(make_index_sequence<FIXED_SIZE_LIMIT>());
+    if (matrixSize < 1 || matrixSize > FIXED_SIZE_LIMIT) {
+        throw invalid_argument("Error: No fixed-size solver for this system size.");
+    }
+    solvers[matrixSize - 1](circuit, voltages);
+}
+
+
+// Helper: Backend Names
+
+const char* backendName(SolverBackend backend) {
+    switch (backend) {
+    case BACKEND_DENSE: return "Dense MNA";
+    case BACKEND_SPARSE_DIRECT: return "Sparse Cholesky";
+    case BACKEND_ITERATIVE: return "Iterative PCG";
+    case BACKEND_OUT_OF_CORE: return "Out-of-core Cholesky";
+    case BACKEND_CACHED: return "Result cache";
+    default: return "Auto";
+    }
+}
+
+// Helper: flops of a Jacobi PCG run (one SpMV, three axpys, two dots and
+// the diagonal scaling per iteration), for the --stats GFLOP/s figure
+static double pcgFlops(const SparseMatrix& A, int iterations) {
+    return (double)iterations * (2.0 * (double)A.nnz() + 11.0 * (double)A.n);
+}
+
+// MNA size up to which the dense path beats the sparse setup cost
+const int DENSE_AUTO_LIMIT = 200;
+
+// loadCircuit() tokenizes this many lines before adding them to the circuit
+const size_t LOAD_BATCH_LINES = 4096;
+
+// Progressive solve: coarsen until the preview system is at most this big
+const int PROGRESSIVE_COARSE_UNKNOWNS = 20000;
+
+// Console logger used by the interactive CLI
+
+Logger consoleLogger() {
+    return [](LogLevel level, const string& message) {
+        if (level == LOG_WARNING) cerr << "Warning: " << message << "\n";
+        else cout << message << "\n";
+    };
+}
+
+// Supernodal analysis of one topology, shared by a circuit and its forks
+struct SymbolicCache {
+    unsigned long long topology;
+    SupernodalStructure structure;
+    long long nnzL;
+};
+
+// Helper: process-wide topology IDs, so forks that diverge never collide
+unsigned long long Circuit::newTopology() {
+    static atomic<unsigned long long> next{1};
+    return next++;
+}
+
+// Helper: unique scratch file for an out-of-core factor
+string Circuit::scratchFilePath() const {
+    static atomic<unsigned> counter{0};
+    string dir = scratchDirectory.empty() ? filesystem::temp_directory_path().string() : scratchDirectory;
+    unsigned long long stamp = chrono::steady_clock::now().time_since_epoch().count();
+    return (filesystem::path(dir) / ("circuit_factor_" + to_string(stamp) + "_" + to_string(counter++) + ".bin")).string();
+}
+
+
+// Helper: factor file of a reduced nodal matrix (by its matrixHash()) in
+// the cache directory
+static string factorCachePath(const string& dir, unsigned long long key) {
+    char name[40];
+    snprintf(name, sizeof(name), "factor_%016llx.bin", key);
+    return (filesystem::path(dir) / name).string();
+}
+
+// Helper: entries of L (diagonal included) in a supernodal structure
+static long long factorNonzeros(const SupernodalStructure& S) {
+    long long total = 0;
+    for (int s = 0; s < S.supernodes(); s++) {
+        long long k = S.cols(s), m = S.rows(s);
+        total += k * m - k * (k - 1) / 2;
+    }
+    return total;
+}
+
+
 // Circuit::solve() Implementation
 
-void Circuit::solve() {
-    try {
-        if (nodeCount == 0) throw runtime_error("Circuit is empty. Add components first.");
+void Circuit::checkSolvable() const {
+    if (nodeCount == 0) throw runtime_error("Circuit is empty. Add components first.");
 
-        // PRE-CHECK: Ensure at least one component connects to Ground (ID 0)
-        bool groundConnected = false;
-        for (const auto& comp : components) {
-            if (comp->nodeA_ID == 0 || comp->nodeB_ID == 0) {
-                groundConnected = true;
-                break;
-            }
+    // PRE-CHECK: Ensure at least one component connects to Ground (ID 0)
+    bool groundConnected = false;
+    for (const auto& comp : *components) {
+        if (comp->nodeA_ID == 0 || comp->nodeB_ID == 0) {
+            groundConnected = true;
+            break;
         }
-        if (!groundConnected) {
-            throw runtime_error("No Ground reference! At least one component must connect to node '0' or 'GND'.");
+    }
+    if (!groundConnected) {
+        throw runtime_error("No Ground reference! At least one component must connect to node '0' or 'GND'.");
+    }
+}
+
+Status Circuit::solve() {
+    try {
+        checkSolvable();
+        stopRefinement(); // Its CG result must not replace this solve's later
+        stats.resetSolve();
+
+        // A circuit solved before (under any names and component order)
+        CanonicalCircuit canonical;
+        if (!resultCacheDirectory.empty()) {
+            canonical = canonicalizeCircuit(*this);
+            vector<double> cached;
+            if (lookupCachedResult(resultCacheDirectory, canonical, cached)) {
+                lastBackend = BACKEND_CACHED;
+                stats.backend = backendName(lastBackend);
+                applyVoltages(cached);
+                if (logger) logger(LOG_INFO, "Results from cache (" + resultCacheDirectory + ")");
+                return Status();
+            }
         }
 
         int vSourceCount = 0;
-        for (const auto& comp : components) if (comp->getType() == VOLTAGE_SOURCE) vSourceCount++;
+        for (const auto& comp : *components) if (comp->getType() == VOLTAGE_SOURCE) vSourceCount++;
         int matrixSize = nodeCount + vSourceCount;
 
-        vector<vector<double>> A(matrixSize, vector<double>(matrixSize, 0.0));
-        vector<double> B(matrixSize, 0.0);
-        int vSourceIndex = 0;
+        // Candidate backends in order of preference. Under a memory budget
+        // AUTO may fall back to CG and finally to the out-of-core factorization
+        vector<SolverBackend> candidates;
+        if (backend != BACKEND_AUTO) {
+            candidates.push_back(backend);
+        } else {
+            if (matrixSize <= DENSE_AUTO_LIMIT) candidates.push_back(BACKEND_DENSE);
+            candidates.push_back(BACKEND_SPARSE_DIRECT);
+            if (maxMemoryBytes > 0) {
+                candidates.push_back(BACKEND_ITERATIVE);
+                candidates.push_back(BACKEND_OUT_OF_CORE);
+            }
+        }
 
-        cout << "Building MNA System (" << matrixSize << "x" << matrixSize << ")..." << endl;
+        // The reduced system and its supernodal structure are built on demand
+        // and reused by the solve itself, so estimating costs no extra work
+        NodalSystem sys;
+        size_t ioBlockBytes = SparseCholesky::DEFAULT_IO_BLOCK_BYTES;
+        bool haveSystem = false, haveStructure = false;
+        auto prepareSystem = [&]() {
+            if (haveSystem) return;
+            ScopedPhase timer(stats, PHASE_ASSEMBLY);
+            sys = buildNodalSystem(*this);
+            haveSystem = true;
+        };
+        auto prepareStructure = [&]() {
+            prepareSystem();
+            if (haveStructure) return;
+            // Value edits keep the topology, so a cached analysis (possibly
+            // inherited from the circuit this one was forked from) still fits
+            if (!symbolic || symbolic->topology != topology) {
+                ScopedPhase timer(stats, PHASE_ORDERING);
+                MemoryScope memory(MEM_FACTORS);
+                SymbolicFactor sym = symbolicAnalysis(sys.A, minimumDegreeOrdering(sys.A));
+                symbolic = make_shared<const SymbolicCache>(
+                    SymbolicCache{topology, analyzeSupernodal(sys.A, sym), sym.nnzL});
+            }
+            stats.nnzL = symbolic->nnzL;
+            stats.supernodes = symbolic->structure.supernodes();
+            haveStructure = true;
+        };
+        auto estimate = [&](SolverBackend c) {
+            if (c == BACKEND_DENSE) return estimateDense(matrixSize);
+            if (c == BACKEND_ITERATIVE) { prepareSystem(); return estimateIterative(sys.A, pseudoDiameter(sys.A)); }
+            prepareStructure();
+            const SupernodalStructure& structure = symbolic->structure;
+            if (c == BACKEND_SPARSE_DIRECT) {
+                BackendEstimate e = estimateSparseDirect(sys.A, structure);
+                // Parallel subtrees each bring their own fronts and stack
+                if (parallelFor) e.memoryBytes += partitionSubtrees(structure, parallelWidth).workspaceEntries * sizeof(double);
+                return e;
+            }
+            // Shrink the I/O blocks until the spilled factorization fits
+            if (maxMemoryBytes > 0) ioBlockBytes = outOfCoreBlockBytes(sys.A, structure, maxMemoryBytes);
+            return estimateOutOfCore(sys.A, structure, ioBlockBytes);
+        };
+
+        // Progress and cancellation hooks, only set up when solving for solveAsync()
+        FactorizationCallback onFactor;
+        IterationCallback onIteration;
+        if (progress || cancelFlag) {
+            onFactor = [this](double fraction) {
+                if (progress) progress({PHASE_FACTORIZATION, fraction, 0, 0});
+                return !cancelRequested();
+            };
+            onIteration = [this](int iteration, double residual) {
+                if (progress) progress({PHASE_ITERATIVE_SOLVE, 0, iteration, residual});
+                return !cancelRequested();
+            };
+        }
 
-        for (const auto& comp : components) {
-            if (comp->getType() == RESISTOR) {
-                Resistor* r = static_cast<Resistor*>(comp.get());
-                double g = r->getConductance();
-                int u = r->nodeA_ID, v = r->nodeB_ID;
-                if (u!=0) { A[u-1][u-1]+=g; if(v!=0) A[u-1][v-1]-=g; }
-                if (v!=0) { A[v-1][v-1]+=g; if(u!=0) A[v-1][u-1]-=g; }
+        vector<double> voltages; // Indexed by node ID
+        string tried;            // Why earlier candidates were skipped
+        bool solved = false;
+        for (size_t ci = 0; ci < candidates.size(); ci++) {
+            if (cancelRequested()) throw runtime_error(CANCELLED_MESSAGE);
+            SolverBackend chosen = candidates[ci];
+            // Memory budget: skip candidates predicted not to fit, before any
+            // large allocation happens
+            if (maxMemoryBytes > 0) {
+                BackendEstimate e = estimate(chosen);
+                tried += string("\n    ") + backendName(chosen) + ": needs ~" + formatBytes(e.memoryBytes);
+                if (e.memoryBytes > (double)maxMemoryBytes) continue;
             }
-            else if (comp->getType() == CURRENT_SOURCE) {
-                CurrentSource* cs = static_cast<CurrentSource*>(comp.get());
-                int u = cs->nodeA_ID, v = cs->nodeB_ID;
-                if (u!=0) B[u-1] -= cs->value;
-                if (v!=0) B[v-1] += cs->value;
+            lastBackend = chosen;
+            stats.backend = backendName(chosen);
+
+            if (chosen == BACKEND_DENSE && matrixSize <= FIXED_SIZE_LIMIT) {
+                // Tiny systems: straight into std::arrays, nothing on the heap
+                if (logger) logger(LOG_INFO, "Building MNA System (" + to_string(matrixSize) + "x" + to_string(matrixSize) + ")...");
+                voltages.assign(nodeCount + 1, 0.0);
+                {
+                    ScopedPhase timer(stats, PHASE_FACTORIZATION);
+                    solveFixedMNA(*this, matrixSize, voltages);
+                }
+                if (onFactor && !onFactor(1.0)) throw runtime_error(CANCELLED_MESSAGE);
+                stats.unknowns = matrixSize;
+                double n = matrixSize;
+                stats.addFlops(PHASE_FACTORIZATION, 2.0 / 3.0 * n * n * n + 2.0 * n * n);
+                solved = true;
+                break;
             }
-            else if (comp->getType() == VOLTAGE_SOURCE) {
-                VoltageSource* vs = static_cast<VoltageSource*>(comp.get());
-                int rIdx = nodeCount + vSourceIndex;
-                int p = vs->nodeA_ID, n = vs->nodeB_ID;
-                if (p!=0) { A[p-1][rIdx] = 1; A[rIdx][p-1] = 1; }
-                if (n!=0) { A[n-1][rIdx] = -1; A[rIdx][n-1] = -1; }
-                B[rIdx] = vs->value;
-                vSourceIndex++;
+            if (chosen == BACKEND_DENSE) {
+                if (logger) logger(LOG_INFO, "Building MNA System (" + to_string(matrixSize) + "x" + to_string(matrixSize) + ")...");
+                vector<vector<double>> A;
+                vector<double> B;
+                {
+                    ScopedPhase timer(stats, PHASE_ASSEMBLY);
+                    assembleMNA(*this, A, B);
+                }
+                stats.unknowns = matrixSize;
+                if (stats.enabled) for (const auto& row : A) for (double a : row) if (a != 0.0) stats.nnzA++;
+
+                // Elimination and back substitution are one routine
+                vector<double> result;
+                {
+                    ScopedPhase timer(stats, PHASE_FACTORIZATION);
+                    result = gaussianElimination(move(A), move(B), onFactor);
+                }
+                double n = matrixSize;
+                stats.addFlops(PHASE_FACTORIZATION, 2.0 / 3.0 * n * n * n + 2.0 * n * n);
+                voltages.assign(nodeCount + 1, 0.0);
+                for (int i = 0; i < nodeCount; i++) voltages[i + 1] = result[i];
+                solved = true;
+                break;
             }
+
+            prepareSystem();
+            if (sys.floatingGroups > 0) throw runtime_error(SINGULAR_MESSAGE);
+
+            if (logger) {
+                logger(LOG_INFO, "Building Reduced Nodal System (" + to_string(sys.unknowns) + " unknowns, " +
+                                 backendName(chosen) + ")...");
+            }
+            stats.unknowns = sys.unknowns;
+            stats.nnzA = sys.A.nnz();
+
+            vector<double> x;
+            if (chosen == BACKEND_ITERATIVE) {
+                IterativeResult it;
+                {
+                    ScopedPhase timer(stats, PHASE_ITERATIVE_SOLVE);
+                    it = pcgSolve(sys.A, sys.b, 1e-10, 0, nullptr, onIteration);
+                }
+                if (cancelRequested()) throw runtime_error(CANCELLED_MESSAGE);
+                stats.iterations += it.iterations;
+                stats.addFlops(PHASE_ITERATIVE_SOLVE, pcgFlops(sys.A, it.iterations));
+                if (!it.converged) {
+                    string failure = "Iterative solver did not converge after " + to_string(it.iterations) +
+                                     " iterations (relative residual " + to_string(it.relativeResidual) + ").";
+                    if (ci + 1 == candidates.size()) throw runtime_error(failure);
+                    if (logger) logger(LOG_WARNING, failure + " Trying the next solver...");
+                    tried += " (did not converge)";
+                    continue;
+                }
+                x = it.x;
+            } else {
+                MemoryScope memory(MEM_FACTORS);
+                SparseCholesky chol;
+                string factorFile;
+                unsigned long long factorKey = 0;
+                bool mapped = false;
+                if (!factorCacheDirectory.empty()) {
+                    factorKey = matrixHash(sys.A);
+                    factorFile = factorCachePath(factorCacheDirectory, factorKey);
+                    ScopedPhase timer(stats, PHASE_FACTORIZATION);
+                    mapped = chol.mapFactor(factorFile, sys.A, factorKey);
+                }
+                if (mapped) {
+                    if (logger) logger(LOG_INFO, "Mapped cached factor " + factorFile);
+                    if (onFactor && !onFactor(1.0)) throw runtime_error(CANCELLED_MESSAGE);
+                    stats.nnzL = factorNonzeros(chol.structure());
+                    stats.supernodes = chol.structure().supernodes();
+                } else {
+                    prepareStructure();
+                    chol.analyze(symbolic->structure);
+                    if (chosen == BACKEND_OUT_OF_CORE) chol.setOutOfCore(scratchFilePath(), ioBlockBytes);
+                    else if (parallelFor) chol.setParallel(parallelFor, parallelWidth);
+                    {
+                        ScopedPhase timer(stats, PHASE_FACTORIZATION);
+                        chol.factorize(sys.A, onFactor);
+                    }
+                    stats.addFlops(PHASE_FACTORIZATION, symbolic->structure.flops);
+                    // A failed save costs the next run a factorization, not this solve
+                    if (!factorFile.empty() && !chol.isOutOfCore()) {
+                        try {
+                            chol.saveFactor(factorFile, sys.A, factorKey);
+                        } catch (const exception& e) {
+                            if (logger) logger(LOG_WARNING, string("Factor not cached: ") + e.what());
+                        }
+                    }
+                }
+                stats.addFlops(PHASE_TRIANGULAR_SOLVE, 4.0 * (double)stats.nnzL);
+                ScopedPhase timer(stats, PHASE_TRIANGULAR_SOLVE);
+                x = chol.solve(sys.b);
+            }
+            voltages = sys.expand(x);
+            solved = true;
+            break;
+        }
+        if (!solved) {
+            throw runtime_error("Memory budget of " + formatBytes((double)maxMemoryBytes) +
+                                " is too small for this circuit:" + tried);
         }
 
-        vector<double> result = gaussianElimination(A, B);
-        
         // Only update voltages if solver succeeded
-        for (int i = 0; i < nodeCount; i++) nodeVoltages[i + 1] = result[i];
-        cout << "Circuit Solved Successfully!" << endl;
+        applyVoltages(voltages);
+        if (!resultCacheDirectory.empty()) {
+            try {
+                storeCachedResult(resultCacheDirectory, canonical, voltages);
+            } catch (const exception& e) {
+                if (logger) logger(LOG_WARNING, string("Result not cached: ") + e.what());
+            }
+        }
+        if (logger) logger(LOG_INFO, "Circuit Solved Successfully!");
+        return Status();
+
+    } catch (const exception& e) {
+        return Status::failure(e.what());
+    }
+}
+
+
+// Circuit::solve(deadline) - Preview Solve with Background Refinement
 
+ApproximateSolution Circuit::solve(chrono::milliseconds deadline) {
+    ApproximateSolution result;
+    try {
+        auto stopAt = chrono::steady_clock::now() + deadline;
+        checkSolvable();
+        stopRefinement();
+        stats.resetSolve();
+
+        NodalSystem sys;
+        {
+            ScopedPhase timer(stats, PHASE_ASSEMBLY);
+            sys = buildNodalSystem(*this);
+        }
+        if (sys.floatingGroups > 0) throw runtime_error(SINGULAR_MESSAGE);
+        lastBackend = BACKEND_ITERATIVE;
+        stats.backend = backendName(lastBackend);
+        stats.unknowns = sys.unknowns;
+        stats.nnzA = sys.A.nnz();
+
+        IterativeResult it;
+        {
+            ScopedPhase timer(stats, PHASE_ITERATIVE_SOLVE);
+            it = pcgSolve(sys.A, sys.b, 1e-10, 0, nullptr, [&](int, double) {
+                return chrono::steady_clock::now() < stopAt;
+            });
+        }
+        stats.iterations = it.iterations;
+        stats.addFlops(PHASE_ITERATIVE_SOLVE, pcgFlops(sys.A, it.iterations));
+        result.converged = it.converged;
+        result.iterations = it.iterations;
+        result.relativeResidual = it.relativeResidual;
+        result.errorEstimate = it.errorEstimate;
+
+        vector<double> voltages = sys.expand(it.x);
+        applyVoltages(voltages, !it.converged);
+        if (it.converged) return result;
+
+        // Keep iterating from the preview on a worker thread. It owns copies
+        // of everything it needs, so the circuit may be edited meanwhile; the
+        // version check in pollRefinement() drops results for an old circuit.
+        auto cancel = make_shared<atomic<bool>>(false);
+        refinementCancel = cancel;
+        refinementVersion = version;
+        refinement = async(launch::async, [sys = move(sys), x = move(it.x), cancel]() {
+            setTraceThreadName("refinement");
+            TraceScope task("refinement", "task");
+            MemoryScope memory(MEM_FACTORS);
+            IterativeResult done = pcgSolve(sys.A, sys.b, 1e-10, 0, &x, [&](int, double) {
+                return !cancel->load();
+            });
+            return done.converged ? sys.expand(done.x) : vector<double>();
+        });
     } catch (const exception& e) {
-        cerr << "\n[SOLVER ERROR]: " << e.what() << "\n" << endl;
+        result.status = Status::failure(e.what());
+    }
+    return result;
+}
+
+bool Circuit::pollRefinement() {
+    if (!refinement.valid() ||
+        refinement.wait_for(chrono::seconds(0)) != future_status::ready) return false;
+    vector<double> voltages = refinement.get();
+    if (voltages.empty() || refinementVersion != version) return false;
+    applyVoltages(voltages);
+    return true;
+}
+
+void Circuit::waitForRefinement() {
+    if (refinement.valid()) refinement.wait();
+    pollRefinement();
+}
+
+void Circuit::stopRefinement() {
+    cancelRefinement();
+    if (refinement.valid()) refinement.wait();
+    refinement = future<vector<double>>();
+}
+
+
+// Circuit::solveProgressive() - Coarse Preview, then Full Solve
+
+Status Circuit::solveProgressive(const function<void()>& onPreview) {
+    // A chosen backend or a cache is honoured only by solve(); a preview
+    // here would bypass both
+    if (backend != BACKEND_AUTO || !factorCacheDirectory.empty() || !resultCacheDirectory.empty()) return solve();
+    try {
+        checkSolvable();
+        stopRefinement();
+        stats.resetSolve();
+
+        NodalSystem sys;
+        {
+            ScopedPhase timer(stats, PHASE_ASSEMBLY);
+            sys = buildNodalSystem(*this);
+        }
+        if (sys.floatingGroups > 0) throw runtime_error(SINGULAR_MESSAGE);
+        stats.unknowns = sys.unknowns;
+        stats.nnzA = sys.A.nnz();
+
+        // Memory budget: the fine system with the CG vectors must fit before
+        // anything is coarsened, and the levels with the coarsest factor
+        // before that is factorized. Otherwise the planner in solve() picks
+        // a backend that fits (or reports that none does).
+        double fineBytes = estimateIterative(sys.A, 1).memoryBytes;
+        auto overBudget = [&](double bytes) {
+            if (maxMemoryBytes == 0 || bytes <= (double)maxMemoryBytes) return false;
+            if (logger) {
+                logger(LOG_WARNING, "Progressive solve needs ~" + formatBytes(bytes) + ", over the memory budget of " +
+                                    formatBytes((double)maxMemoryBytes) + "; solving without a preview.");
+            }
+            return true;
+        };
+        if (overBudget(fineBytes)) return solve();
+
+        CoarseHierarchy hierarchy;
+        {
+            ScopedPhase timer(stats, PHASE_FACTORIZATION);
+            hierarchy.analyze(sys.A, PROGRESSIVE_COARSE_UNKNOWNS);
+        }
+        double progressiveBytes = fineBytes + hierarchy.levelBytes() +
+            estimateSparseDirect(hierarchy.coarseMatrix(), hierarchy.coarseStructure()).memoryBytes;
+        if (overBudget(progressiveBytes)) return solve();
+        {
+            ScopedPhase timer(stats, PHASE_FACTORIZATION);
+            hierarchy.factorize();
+        }
+        int coarseUnknowns = hierarchy.coarseUnknowns();
+        vector<double> guess;
+        {
+            ScopedPhase timer(stats, PHASE_TRIANGULAR_SOLVE);
+            guess = hierarchy.solve(sys.b);
+        }
+        // Small systems are solved exactly at the "coarse" level already
+        bool exact = coarseUnknowns == sys.unknowns;
+        lastBackend = exact ? BACKEND_SPARSE_DIRECT : BACKEND_ITERATIVE;
+        vector<double> voltages = sys.expand(guess);
+        applyVoltages(voltages, !exact);
+
+        if (exact) {
+            stats.backend = backendName(lastBackend);
+            if (logger) logger(LOG_INFO, "Circuit Solved Successfully!");
+            return Status();
+        }
+
+        if (logger) {
+            logger(LOG_INFO, "Coarse Preview Ready (" + to_string(coarseUnknowns) + " aggregates for " +
+                             to_string(sys.unknowns) + " unknowns).");
+        }
+        if (onPreview) onPreview();
+
+        if (logger) logger(LOG_INFO, "Refining on the full system...");
+        stats.backend = backendName(lastBackend);
+        // The hierarchy built for the preview doubles as the preconditioner
+        IterativeResult it;
+        {
+            ScopedPhase timer(stats, PHASE_ITERATIVE_SOLVE);
+            it = pcgSolve(sys.A, sys.b, 1e-10, 0, &guess, nullptr,
+                [&hierarchy](const vector<double>& r, vector<double>& z) { hierarchy.precondition(r, z); });
+        }
+        stats.iterations = it.iterations;
+        if (!it.converged) {
+            throw runtime_error("Iterative solver did not converge after " + to_string(it.iterations) +
+                                " iterations; the coarse preview is kept.");
+        }
+        voltages = sys.expand(it.x);
+        applyVoltages(voltages);
+        if (logger) logger(LOG_INFO, "Circuit Solved Successfully!");
+        return Status();
+
+    } catch (const exception& e) {
+        return Status::failure(e.what());
     }
 }
 
 
 // Circuit::loadCircuit() Implementation
 
-void Circuit::loadCircuit(const string& filename) {
+Status Circuit::loadCircuit(const string& filename) {
     ifstream inFile(filename);
-    if (!inFile) {
-        cerr << "Error: Could not open file " << filename << "\n";
-        return;
-    }
+    if (!inFile) return Status::failure("Could not open file " + filename);
     try {
         clearCircuit();
-        nodeName_to_ID["0"] = 0;
-        nodeName_to_ID["GND"] = 0;
-        nodeName_to_ID["gnd"] = 0;
-
-        string line, type, name, n1, n2;
-        double val;
+        NodeTable& names = writable(nodeName_to_ID);
+        names["0"] = 0;
+        names["GND"] = 0;
+        names["gnd"] = 0;
+
+        // Lines are tokenized and then added in batches, so the load and
+        // interning phases can be timed separately without per-line timers
+        struct ParsedLine { string type, name, n1, n2; double val; };
+        vector<ParsedLine> batch(LOAD_BATCH_LINES);
+        string line;
         int count = 0;
-        while (getline(inFile, line)) {
-            if (line.empty()) continue;
-            stringstream ss(line);
-            if (!(ss >> type >> name >> n1 >> n2 >> val)) {
-                 cerr << "Warning: Skipping malformed line: " << line << endl;
-                 continue;
+        bool more = true;
+        while (more) {
+            size_t filled = 0;
+            {
+                ScopedPhase timer(stats, PHASE_LOAD);
+                while (filled < batch.size() && (more = (bool)getline(inFile, line))) {
+                    if (line.empty()) continue;
+                    stringstream ss(line);
+                    ParsedLine& p = batch[filled];
+                    if (!(ss >> p.type >> p.name >> p.n1 >> p.n2 >> p.val)) {
+                         if (logger) logger(LOG_WARNING, "Skipping malformed line: " + line);
+                         continue;
+                    }
+                    filled++;
+                }
             }
 
-            if (type == "R" || type == "r") addResistor(name, n1, n2, val);
-            else if (type == "I" || type == "i") addCurrentSource(name, n1, n2, val);
-            else if (type == "V" || type == "v") addVoltageSource(name, n1, n2, val);
-            else continue;
-            count++;
+            ScopedPhase timer(stats, PHASE_INTERNING);
+            for (size_t i = 0; i < filled; i++) {
+                const ParsedLine& p = batch[i];
+                if (p.type == "R" || p.type == "r") addResistor(p.name, p.n1, p.n2, p.val);
+                else if (p.type == "I" || p.type == "i") addCurrentSource(p.name, p.n1, p.n2, p.val);
+                else if (p.type == "V" || p.type == "v") addVoltageSource(p.name, p.n1, p.n2, p.val);
+                else continue;
+                count++;
+            }
         }
-        cout << "Loaded " << count << " components.\n";
+        stats.components = (long long)components->size();
+        stats.nodes = nodeCount;
+        if (logger) logger(LOG_INFO, "Loaded " + to_string(count) + " components.");
     } catch (const exception& e) {
-        cerr << "Error loading: " << e.what() << endl;
         clearCircuit();
+        return Status::failure(string("Error loading: ") + e.what());
+    }
+    return Status();
+}
+
+
+// Circuit::applyVoltages()
+
+void Circuit::applyVoltages(const vector<double>& voltages, bool preview) {
+    MemoryScope memory(MEM_RESULTS);
+    for (int i = 1; i <= nodeCount; i++) nodeVoltages[i] = voltages[i];
+
+    // Reuse the older buffer if no reader holds it. The acquire fence pairs
+    // with the release in the last reader's reference drop, so its reads
+    // are finished before the buffer is overwritten. (ThreadSanitizer does
+    // not model standalone fences and reports this reuse as a race.)
+    shared_ptr<ResultSnapshot> next;
+    if (spareSnapshot && spareSnapshot.use_count() == 1) {
+        atomic_thread_fence(memory_order_acquire);
+        next = move(spareSnapshot);
+    } else {
+        next = make_shared<ResultSnapshot>();
+    }
+    next->version = version;
+    next->preview = preview;
+    next->backend = lastBackend;
+    next->voltages.assign(voltages.begin(), voltages.begin() + nodeCount + 1);
+    next->voltages[0] = 0.0;
+    next->nodeIDs = nodeName_to_ID; // Later edits copy the table first
+
+    atomic_store(&published, shared_ptr<const ResultSnapshot>(next));
+    spareSnapshot = move(currentSnapshot);
+    currentSnapshot = move(next);
+}
+
+
+// Circuit::solveAsync() - Solve a Fork on a Worker Thread
+
+SolveTask Circuit::solveAsync(ProgressCallback onProgress) {
+    if (asyncCancel) *asyncCancel = true; // Superseded
+    SolveTask task;
+    task.cancelFlag = make_shared<atomic<bool>>(false);
+    asyncCancel = task.cancelFlag;
+
+    shared_ptr<Circuit> variant = fork();
+    variant->cancelFlag = task.cancelFlag;
+    variant->progress = move(onProgress);
+    task.result = async(launch::async, [variant]() {
+        setTraceThreadName("async solve");
+        TraceScope scope("solve_async", "task");
+        AsyncSolveResult outcome;
+        outcome.status = variant->solve();
+        outcome.cancelled = !outcome.status && variant->cancelRequested();
+        if (outcome.status) outcome.results = variant->snapshot();
+        return outcome;
+    });
+    return task;
+}
+
+bool Circuit::adoptResults(const ResultSnapshot& results) {
+    if (results.version != version || (int)results.voltages.size() != nodeCount + 1) return false;
+    lastBackend = results.backend;
+    applyVoltages(results.voltages, results.preview);
+    return true;
+}
+
+
+// Circuit::fork() and Value Edits
+
+unique_ptr<Circuit> Circuit::fork() const {
+    auto variant = make_unique<Circuit>();
+    variant->components = components;
+    variant->nodeName_to_ID = nodeName_to_ID;
+    variant->nodeCount = nodeCount;
+    variant->topology = topology;
+    variant->symbolic = symbolic;
+    variant->version = version;
+    variant->backend = backend;
+    variant->maxMemoryBytes = maxMemoryBytes;
+    variant->scratchDirectory = scratchDirectory;
+    variant->factorCacheDirectory = factorCacheDirectory;
+    variant->resultCacheDirectory = resultCacheDirectory;
+    variant->logger = logger;
+    variant->stats.enabled = stats.enabled;
+    return variant;
+}
+
+int Circuit::findComponent(const string& name) const {
+    for (size_t i = 0; i < components->size(); i++) {
+        if ((*components)[i]->name == name) return (int)i;
     }
-    inFile.close();
+    return -1;
+}
+
+void Circuit::setComponentValue(int index, double value) {
+    if (index < 0 || index >= (int)components->size()) {
+        throw invalid_argument("Error: Component index out of range.");
+    }
+    const Component& old = *(*components)[index];
+    MemoryScope memory(MEM_COMPONENTS);
+    shared_ptr<const Component> updated; // The constructors validate the value
+    if (old.getType() == RESISTOR) updated = make_shared<Resistor>(old.name, old.nodeA_ID, old.nodeB_ID, value);
+    else if (old.getType() == CURRENT_SOURCE) updated = make_shared<CurrentSource>(old.name, old.nodeA_ID, old.nodeB_ID, value);
+    else updated = make_shared<VoltageSource>(old.name, old.nodeA_ID, old.nodeB_ID, value);
+    writable(components)[index] = move(updated);
+    edited();
+}
+
+void Circuit::setComponentValue(const string& name, double value) {
+    int index = findComponent(name);
+    if (index < 0) throw invalid_argument("Error: No component named '" + name + "'.");
+    setComponentValue(index, value);
+}
+
+
+// ResultSnapshot::voltage()
+
+double ResultSnapshot::voltage(const string& node) const {
+    if (!nodeIDs) return NAN;
+    auto it = nodeIDs->find(node);
+    if (it == nodeIDs->end() || it->second >= (int)voltages.size()) return NAN;
+    return voltages[it->second];
 }
 
 
 // Circuit::displayResults() - FIXED & NUMERICALLY SORTED
 
-void Circuit::displayResults() {
+void Circuit::displayResults(ostream& out) {
+    ScopedPhase timer(stats, PHASE_OUTPUT);
     if (nodeVoltages.size() <= 1) {
-        cout << "No results available. Please solve the circuit first.\n";
+        out << "No results available. Please solve the circuit first.\n";
         return;
     }
 
     // Step 1: Store {NodeName, NodeID} in a vector
     vector<pair<string, int>> sortedNodes;
-    for (const auto& pair : nodeName_to_ID) {
+    for (const auto& pair : *nodeName_to_ID) {
         sortedNodes.push_back({pair.first, pair.second});
     }
 
     // Step 2: Sort using Custom Numerical Comparator
     sort(sortedNodes.begin(), sortedNodes.end(), compareNodes);
 
-    cout << "\n--- Simulation Results ---\n";
+    out << "\n--- Simulation Results ---\n";
     for (const auto& pair : sortedNodes) {
         string name = pair.first;
         int id = pair.second;
@@ -204,29 +851,29 @@ void Circuit::displayResults() {
         if (id == 0) continue; 
 
         if (nodeVoltages.find(id) != nodeVoltages.end()) {
-            cout << "Node [" << name << "]: " 
-                 << fixed << setprecision(3) << nodeVoltages[id] << " V" << endl;
+            out << "Node [" << name << "]: " 
+                 << fixed << setprecision(3) << nodeVoltages[id] << " V\n";
         }
     }
-    cout << "--------------------------\n";
+    out << "--------------------------\n";
 }
 
 
 // Circuit::saveCircuit()
 
-void Circuit::saveCircuit(const string& filename) {
+Status Circuit::saveCircuit(const string& filename) {
+    ScopedPhase timer(stats, PHASE_OUTPUT);
     ofstream outFile(filename);
-    if (!outFile.is_open()) {
-        cerr << "Error: Could not save to file " << filename << endl;
-        return;
-    }
+    if (!outFile.is_open()) return Status::failure("Could not save to file " + filename);
 
     unordered_map<int, string> id_to_name;
-    for (const auto& pair : nodeName_to_ID) {
+    for (const auto& pair : *nodeName_to_ID) {
         id_to_name[pair.second] = pair.first;
     }
+    // Full precision, so a saved circuit solves exactly like the original
+    outFile << setprecision(17);
 
-    for (const auto& comp : components) {
+    for (const auto& comp : *components) {
          char typeChar = 'R';
          if (comp->getType() == CURRENT_SOURCE) typeChar = 'I';
          if (comp->getType() == VOLTAGE_SOURCE) typeChar = 'V';
@@ -239,14 +886,16 @@ void Circuit::saveCircuit(const string& filename) {
                  << comp->value << "\n";
     }
     outFile.close();
-    cout << "Circuit saved to " << filename << endl;
+    if (!outFile) return Status::failure("Could not write " + filename);
+    if (logger) logger(LOG_INFO, "Circuit saved to " + filename);
+    return Status();
 }
 
 
 // Circuit::visualizeCircuit()
 
 void Circuit::visualizeCircuit() {
-    if (nodeName_to_ID.empty()) {
+    if (nodeName_to_ID->empty()) {
         cout << "Circuit is empty. Nothing to visualize.\n";
         return;
     }
@@ -255,7 +904,7 @@ void Circuit::visualizeCircuit() {
     
     // Sort names numerically here too
     vector<pair<string, int>> sortedNodes;
-    for (const auto& pair : nodeName_to_ID) sortedNodes.push_back({pair.first, pair.second});
+    for (const auto& pair : *nodeName_to_ID) sortedNodes.push_back({pair.first, pair.second});
     sort(sortedNodes.begin(), sortedNodes.end(), compareNodes);
 
     for (const auto& pair : sortedNodes) {
@@ -266,7 +915,7 @@ void Circuit::visualizeCircuit() {
 
         bool hasConnection = false;
         
-        for (const auto& comp : components) {
+        for (const auto& comp : *components) {
             int neighborID = -1;
             string arrow = "";
 
@@ -286,7 +935,7 @@ void Circuit::visualizeCircuit() {
             if (neighborID != -1) {
                 hasConnection = true;
                 string neighborName = "Unknown";
-                for(const auto& p : nodeName_to_ID) { 
+                for(const auto& p : *nodeName_to_ID) { 
                     if(p.second == neighborID) { neighborName = p.first; break; } 
                 }
 
@@ -10,6 +10,13 @@
 #include <cmath>    // For math operations
 #include <iomanip>  // For output formatting
 #include <stdexcept> // Needed for error handling
+#include <chrono>    // For deadline-bounded solves
+#include <future>    // For background refinement
+#include <atomic>
+#include <functional>
+#include <array>
+#include <utility>
+#include "SolverStats.h"
 
 using namespace std;
 
@@ -20,6 +27,100 @@ enum ComponentType {
     VOLTAGE_SOURCE
 };
 
+// Linear solvers available to Circuit::solve()
+enum SolverBackend {
+    BACKEND_AUTO,          // Dense for small systems, sparse otherwise (budget-aware)
+    BACKEND_DENSE,         // Full MNA matrix + gaussianElimination()
+    BACKEND_SPARSE_DIRECT, // Supernodal Cholesky on the reduced nodal system
+    BACKEND_ITERATIVE,     // Jacobi-preconditioned CG on the reduced nodal system
+    BACKEND_OUT_OF_CORE,   // Sparse Cholesky with the factor spilled to a scratch file
+    BACKEND_CACHED         // Reported only: results came from the result cache
+};
+
+const char* backendName(SolverBackend backend);
+extern const int DENSE_AUTO_LIMIT; // MNA size up to which BACKEND_AUTO solves densely
+
+// Outcome of solve(), solveProgressive(), loadCircuit() and saveCircuit().
+// A failed solve keeps the previous results; a failed load leaves the
+// circuit empty.
+struct Status {
+    bool ok = true;
+    string error; // What went wrong, when !ok
+
+    static Status failure(const string& message) { return {false, message}; }
+    explicit operator bool() const { return ok; }
+};
+
+// Progress and warning messages of a circuit. The library never writes to
+// the console on its own; without a logger nothing is even formatted.
+enum LogLevel {
+    LOG_INFO,    // Progress ("Building MNA System ...", "Loaded 12 components.")
+    LOG_WARNING  // Recoverable problems (malformed lines, solver fallbacks)
+};
+
+using Logger = function<void(LogLevel level, const string& message)>;
+
+// Info to cout and warnings to cerr, as the interactive CLI prints them
+Logger consoleLogger();
+
+// Immutable results of one solve, published by Circuit::applyVoltages().
+// Readers keep the snapshot alive for as long as they hold the pointer, so
+// the voltages and name table they see always belong together.
+struct ResultSnapshot {
+    unsigned long long version = 0; // Circuit edit version the voltages belong to
+    bool preview = false;           // Approximate (deadline or progressive preview)
+    SolverBackend backend = BACKEND_AUTO;
+    vector<double> voltages;        // By node ID, index 0 = ground
+    shared_ptr<const unordered_map<string, int>> nodeIDs; // Name table of that version
+
+    // NaN when the node did not exist in this version
+    double voltage(const string& node) const;
+};
+
+// Outcome of a deadline-bounded solve, see Circuit::solve(deadline)
+struct ApproximateSolution {
+    Status status;
+    bool converged = false;      // False: results are a preview, refinement continues
+    int iterations = 0;
+    double relativeResidual = 0;
+    double errorEstimate = 0;    // Estimated voltage error (Volts)
+};
+
+// Progress of a solveAsync() run: direct solvers report after every
+// supernode (or dense pivot row), CG after every iteration
+struct SolveProgress {
+    StatPhase phase = PHASE_FACTORIZATION; // Or PHASE_ITERATIVE_SOLVE
+    double fraction = 0;  // Factorization: share of its flops done, 0..1
+    int iteration = 0;    // CG: iterations so far
+    double residual = 0;  // CG: relative residual
+};
+
+// Runs on the solving thread, so it should be quick and thread-safe
+using ProgressCallback = function<void(const SolveProgress&)>;
+
+// Outcome of solveAsync(). On success `results` holds the voltages of the
+// circuit as it was when the solve started (see Circuit::adoptResults()).
+struct AsyncSolveResult {
+    Status status;
+    bool cancelled = false;
+    shared_ptr<const ResultSnapshot> results;
+};
+
+// Handle of a solveAsync() run. Destroying it waits for the solve to end,
+// so cancel() first to abandon it quickly.
+struct SolveTask {
+    future<AsyncSolveResult> result;
+    shared_ptr<atomic<bool>> cancelFlag;
+
+    // Cooperative: checked after every supernode, pivot row or CG iteration
+    void cancel() const { if (cancelFlag) *cancelFlag = true; }
+};
+
+// Fork-join hook for a parallel factorization: runs body(0) .. body(count-1),
+// possibly on other threads, and returns once all have finished, rethrowing
+// the first exception. SolveScheduler provides one for its jobs.
+typedef function<void(int, const function<void(int)>&)> ParallelFor;
+
 
 // 1. Component Classes (Inheritance/Polymorphism)
 
@@ -109,29 +210,105 @@ public:
 // 2. Circuit Manager Class (The "Graph")
 
 
+// Components are immutable once added (a value change swaps in a new one),
+// so the list and the name table can be shared between circuits
+using ComponentList = vector<shared_ptr<const Component>>;
+using NodeTable = unordered_map<string, int>;
+
+struct SymbolicCache; // Supernodal analysis of one topology (CircuitSolver.cpp)
+
 class Circuit {
 private:
-    // List of all components in the circuit (using smart pointers for safety)
-    vector<unique_ptr<Component>> components;
+    // List of all components in the circuit, shared with forks until the
+    // first write (copy-on-write, see writable())
+    shared_ptr<const ComponentList> components;
 
     // Hash Map to link user-friendly names ("Vout") to internal IDs (0, 1, 2)
     // Key: Node Name (string), Value: Matrix Index (int)
-    unordered_map<string, int> nodeName_to_ID;
+    // Shared with forks and with the published result snapshots.
+    shared_ptr<const NodeTable> nodeName_to_ID;
+
+    // Topology identity: a new process-wide ID whenever a component is added
+    // or the circuit is cleared, never for value changes. The symbolic
+    // factorization is cached per topology and shared with forks.
+    unsigned long long topology;
+    shared_ptr<const SymbolicCache> symbolic;
+    static unsigned long long newTopology();
+
+    // Helper: copy-on-write access. A store still shared (with a fork or a
+    // result snapshot) is copied first; a sole owner writes in place. The
+    // acquire fence pairs with the release of the last other owner.
+    template <class T> static T& writable(shared_ptr<const T>& shared) {
+        if (shared.use_count() != 1) shared = make_shared<T>(*shared);
+        else atomic_thread_fence(memory_order_acquire);
+        return const_cast<T&>(*shared); // Always created non-const above or in the constructor
+    }
 
     // Store results: Node ID -> Voltage Value
     unordered_map<int, double> nodeVoltages;
 
     int nodeCount = 0; // Counter for unique nodes assigned
 
+    // Published results (RCU style): readers atomically load `published`
+    // and never block the writer. The writer double-buffers: the previous
+    // snapshot is recycled once no reader holds it any more, so steady-state
+    // re-solves publish without allocating.
+    shared_ptr<const ResultSnapshot> published;
+    shared_ptr<ResultSnapshot> currentSnapshot, spareSnapshot;
+
+    // Solver settings (kept across clearCircuit)
+    SolverBackend backend = BACKEND_AUTO;
+    size_t maxMemoryBytes = 0; // 0 = no memory budget
+    SolverBackend lastBackend = BACKEND_AUTO; // Backend used by the last solve()
+    string scratchDirectory;   // Out-of-core factor files; empty = system temp dir
+    string factorCacheDirectory; // Persistent sparse factors; empty = off
+    string resultCacheDirectory; // Solved circuits by canonical form; empty = off
+
+    string scratchFilePath() const;
+
+    // Background refinement started by solve(deadline). Results carry the
+    // edit version they were computed for; stale ones are dropped.
+    unsigned long long version = 0; // Bumped on every edit
+    future<vector<double>> refinement;
+    unsigned long long refinementVersion = 0;
+    shared_ptr<atomic<bool>> refinementCancel;
+
+    void cancelRefinement() { if (refinementCancel) *refinementCancel = true; }
+
+    // solveAsync() solves a fork on a worker thread. An edit here cancels the
+    // latest one; the fork's solve() polls cancelFlag and reports progress.
+    shared_ptr<atomic<bool>> asyncCancel;
+    shared_ptr<atomic<bool>> cancelFlag; // Set on the fork only
+    ProgressCallback progress;            // Set on the fork only
+    bool cancelRequested() const { return cancelFlag && cancelFlag->load(memory_order_relaxed); }
+
+    void edited() {
+        version++;
+        if (asyncCancel) *asyncCancel = true;
+        cancelRefinement(); // Its result would be discarded anyway
+    }
+    void stopRefinement(); // Cancel and wait, discarding the result
+
+    // Subtree-parallel sparse factorization (see setParallelism())
+    ParallelFor parallelFor;
+    int parallelWidth = 1;
+
+    SolverStats stats; // Per-phase timings, recorded only while enabled
+
+    // Empty: silent. Messages are built only behind an `if (logger)` check.
+    Logger logger;
+
 public:
     // Constructor
-    Circuit() {
+    Circuit() : components(make_shared<ComponentList>()), topology(newTopology()) {
         // Always reserve ID 0 for Ground (GND)
-        nodeName_to_ID["GND"] = 0;
-        nodeName_to_ID["0"] = 0;
+        nodeName_to_ID = make_shared<NodeTable>(NodeTable{{"GND", 0}, {"0", 0}});
         nodeVoltages[0] = 0.0; // Ground is always 0V
     }
 
+    // Stop any background refinement (the future waits for it to return)
+    ~Circuit() { cancelRefinement(); }
+
     // --- Feature: Dynamic Circuit Creation ---
     
     // Helper to get or create a node ID from a string name
@@ -139,56 +316,310 @@ public:
         if (nodeName.empty()) {
             throw invalid_argument("Error: Node name cannot be empty.");
         }
-        if (nodeName_to_ID.find(nodeName) == nodeName_to_ID.end()) {
+        auto it = nodeName_to_ID->find(nodeName);
+        if (it == nodeName_to_ID->end()) {
             // New node found
+            MemoryScope memory(MEM_NAME_TABLE);
             nodeCount++;
-            nodeName_to_ID[nodeName] = nodeCount;
+            writable(nodeName_to_ID)[nodeName] = nodeCount;
             return nodeCount;
         }
-        return nodeName_to_ID[nodeName];
+        return it->second;
     }
 
     void addResistor(string name, string n1, string n2, double resistance) {
         int id1 = getNodeID(n1);
         int id2 = getNodeID(n2);
         // Validation happens inside Resistor constructor
-        components.push_back(make_unique<Resistor>(name, id1, id2, resistance));
+        MemoryScope memory(MEM_COMPONENTS);
+        writable(components).push_back(make_shared<Resistor>(name, id1, id2, resistance));
+        topology = newTopology();
+        edited();
     }
 
     void addCurrentSource(string name, string nFrom, string nTo, double current) {
         int id1 = getNodeID(nFrom);
         int id2 = getNodeID(nTo);
-        components.push_back(make_unique<CurrentSource>(name, id1, id2, current));
+        MemoryScope memory(MEM_COMPONENTS);
+        writable(components).push_back(make_shared<CurrentSource>(name, id1, id2, current));
+        topology = newTopology();
+        edited();
     }
 
     void addVoltageSource(string name, string nPos, string nNeg, double voltage) {
         int id1 = getNodeID(nPos);
         int id2 = getNodeID(nNeg);
-        components.push_back(make_unique<VoltageSource>(name, id1, id2, voltage));
+        MemoryScope memory(MEM_COMPONENTS);
+        writable(components).push_back(make_shared<VoltageSource>(name, id1, id2, voltage));
+        topology = newTopology();
+        edited();
     }
-    
+
+    // --- Feature: Value Edits (topology unchanged) ---
+    // Swaps in a new component, so forks sharing the old one are unaffected.
+    // Throws invalid_argument for an unknown component or an invalid value.
+    int findComponent(const string& name) const; // -1 if none (linear scan)
+    void setComponentValue(int index, double value);
+    void setComponentValue(const string& name, double value);
+
     void clearCircuit() {
-        components.clear();
-        nodeName_to_ID.clear();
+        components = make_shared<ComponentList>();
         nodeVoltages.clear();
         nodeCount = 0;
+        topology = newTopology();
+        symbolic.reset();
+        edited();
+        stats.reset();
+        atomic_store(&published, shared_ptr<const ResultSnapshot>());
+        currentSnapshot.reset();
+        spareSnapshot.reset();
         // Re-initialize ground
-        nodeName_to_ID["GND"] = 0;
+        nodeName_to_ID = make_shared<NodeTable>(NodeTable{{"GND", 0}});
         nodeVoltages[0] = 0.0;
     }
 
+    // --- Feature: Copy-on-write Variants ---
+    // A fork shares the component list, the name table and the cached
+    // symbolic factorization with this circuit; whichever side writes first
+    // copies the list (pointers only) or the table, and a value change
+    // allocates just the one new component. Settings and the logger are
+    // copied, results are not. Call it from the thread that edits this
+    // circuit; the fork is independent and may be solved on another thread.
+    unique_ptr<Circuit> fork() const;
+
+    // --- Feature: Logging (none by default) ---
+    void setLogger(Logger l) { logger = move(l); }
+
+    // --- Feature: Phase Timing Statistics ---
+    void enableStats(bool on = true) { stats.enabled = on; }
+    // Also enables the statistics. False when the counters cannot be opened
+    // (reason in getStats().countersReason); timings keep working then.
+    bool enableHardwareCounters() { stats.enabled = true; return stats.enableHardwareCounters(); }
+    const SolverStats& getStats() const { return stats; }
+
+    // --- Feature: Memory Accounting ---
+    // Also enables the statistics. The allocation counters are process-wide
+    // (see MemoryTracker.h), so they cover every circuit in the process.
+    void enableMemoryTracking() {
+        stats.enabled = true;
+        stats.trackMemory = true;
+        ::enableMemoryTracking();
+    }
+
+    // --- Feature: Read-only Access (used by the analysis and sparse solvers) ---
+    const ComponentList& getComponents() const { return *components; }
+    const NodeTable& getNodeMap() const { return *nodeName_to_ID; }
+    int getNodeCount() const { return nodeCount; }
+    const unordered_map<int, double>& getNodeVoltages() const { return nodeVoltages; }
+
+    // --- Feature: Solver Selection and Memory Budget ---
+    // With a budget, solve() predicts the peak memory of each candidate
+    // backend before allocating anything and fails fast if none fits.
+    void setBackend(SolverBackend b) {
+        if (b == BACKEND_CACHED) throw invalid_argument("Error: The result cache is not a selectable backend.");
+        backend = b;
+    }
+    void setMaxMemory(size_t bytes) { maxMemoryBytes = bytes; }
+    size_t getMaxMemory() const { return maxMemoryBytes; }
+    SolverBackend getLastBackend() const { return lastBackend; }
+    void setScratchDirectory(const string& dir) { scratchDirectory = dir; }
+
+    // --- Feature: Persistent Factor Cache ---
+    // Sparse solves save their factor in `dir`, in a file named after a hash
+    // of the reduced nodal matrix (topology and resistances; source values
+    // only change the right-hand side). A later solve of the same matrix,
+    // in this or any other process, maps that file instead of ordering and
+    // factorizing, and only runs the triangular solves. Empty turns it off.
+    void setFactorCacheDirectory(const string& dir) { factorCacheDirectory = dir; }
+
+    // --- Feature: Result Cache ---
+    // solve() looks the circuit up in `dir` by its canonical form (see
+    // ResultCache.h), which ignores component order and node and component
+    // names. On a hit the stored voltages are applied under this circuit's
+    // node names without building or factorizing anything; otherwise the
+    // results are stored there after a successful solve. Empty turns it off.
+    void setResultCacheDirectory(const string& dir) { resultCacheDirectory = dir; }
+
+    // --- Feature: Parallel Factorization ---
+    // Lets the sparse factorization spread independent subtrees over up to
+    // `width` threads through `runner` (SolveScheduler sets this for the
+    // jobs it runs). Results are bitwise identical to the serial solve.
+    // Not copied by fork(); an empty runner turns it off.
+    void setParallelism(ParallelFor runner, int width) {
+        parallelFor = move(runner);
+        parallelWidth = parallelFor ? max(1, width) : 1;
+    }
+
     // --- Feature: Nodal Analysis Solver ---
-    void solve();
+    Status solve();
+    void checkSolvable() const; // Throws if the circuit is empty or has no ground
+
+    // --- Feature: Asynchronous Solve ---
+    // Solves a fork of the circuit (see fork()) on a worker thread, so this
+    // circuit may be edited meanwhile; any edit, or a newer solveAsync(),
+    // cancels the run. The fork's statistics are not merged back.
+    SolveTask solveAsync(ProgressCallback onProgress = nullptr);
+
+    // Install results of solveAsync() if the circuit has not been edited
+    // since that solve started; false (and nothing changes) otherwise
+    bool adoptResults(const ResultSnapshot& results);
+
+    // --- Feature: Deadline-bounded Preview Solve ---
+    // Runs CG until the deadline and stores the current iterate as the
+    // results. If it has not converged, refinement continues on a background
+    // thread; pollRefinement() installs the final voltages once ready.
+    ApproximateSolution solve(chrono::milliseconds deadline);
+    bool isRefining() const { return refinement.valid(); }
+    bool pollRefinement(); // True if refined results were just installed
+    void waitForRefinement();
+
+    // --- Feature: Coarse-to-Fine Progressive Solve ---
+    // Solves an aggregated (coarse) version of the circuit first, stores
+    // those voltages and calls onPreview, then refines with CG on the full
+    // system starting from the prolongated coarse solution. Under a memory
+    // budget it is sized first; if it does not fit, this is solve(). With a
+    // backend other than BACKEND_AUTO, or a factor or result cache, it is
+    // solve() as well.
+    Status solveProgressive(const function<void()>& onPreview = nullptr);
 
     // --- Feature: Results Display ---
-    void displayResults(); // Implementation is in .cpp
+    void displayResults(ostream& out = cout); // Implementation is in .cpp
+
+    // Install solver output indexed by node ID (index 0 = ground) and
+    // publish it as the new ResultSnapshot
+    void applyVoltages(const vector<double>& voltages, bool preview = false);
+
+    // --- Feature: Concurrent Readers ---
+    // The only member that may be called while another thread edits or
+    // solves: a Circuit has one writer, any number of snapshot readers.
+    // Null before the first solve and after clearCircuit().
+    shared_ptr<const ResultSnapshot> snapshot() const { return atomic_load(&published); }
 
     // --- Feature: File I/O (Save/Load) ---
-    void saveCircuit(const string& filename); // Implementation is in .cpp
-    void loadCircuit(const string& filename);
+    Status saveCircuit(const string& filename); // Implementation is in .cpp
+    Status loadCircuit(const string& filename);
 
     // --- Feature: Visualization ---
     void visualizeCircuit();
 };
 
+
+// 3. Dense Solver Helpers
+
+
+// Called during a factorization with the share of its work done (0..1);
+// returning false abandons it with runtime_error(CANCELLED_MESSAGE)
+typedef function<bool(double)> FactorizationCallback;
+extern const char* const CANCELLED_MESSAGE;
+extern const char* const SINGULAR_MESSAGE; // Defined with the sparse solver
+
+// Gaussian elimination with partial pivoting (takes copies; A is destroyed).
+// keepGoing is called after every pivot row.
+vector<double> gaussianElimination(vector<vector<double>> A, vector<double> B,
+                                   const FactorizationCallback& keepGoing = nullptr);
+
+// Dense MNA system of the circuit: node equations, then one row per voltage source
+void assembleMNA(const Circuit& circuit, vector<vector<double>>& A, vector<double>& B);
+
+// Stamping rules of assembleMNA() into caller-sized, zeroed storage of any
+// indexable type, so the fixed-size path below shares them
+template<class Matrix, class Vector>
+void stampMNA(const Circuit& circuit, Matrix& A, Vector& B) {
+    int nodeCount = circuit.getNodeCount();
+    int vSourceIndex = 0;
+    for (const auto& comp : circuit.getComponents()) {
+        if (comp->getType() == RESISTOR) {
+            const Resistor* r = static_cast<const Resistor*>(comp.get());
+            double g = r->getConductance();
+            int u = r->nodeA_ID, v = r->nodeB_ID;
+            if (u!=0) { A[u-1][u-1]+=g; if(v!=0) A[u-1][v-1]-=g; }
+            if (v!=0) { A[v-1][v-1]+=g; if(u!=0) A[v-1][u-1]-=g; }
+        }
+        else if (comp->getType() == CURRENT_SOURCE) {
+            int u = comp->nodeA_ID, v = comp->nodeB_ID;
+            if (u!=0) B[u-1] -= comp->value;
+            if (v!=0) B[v-1] += comp->value;
+        }
+        else if (comp->getType() == VOLTAGE_SOURCE) {
+            int rIdx = nodeCount + vSourceIndex;
+            int p = comp->nodeA_ID, n = comp->nodeB_ID;
+            if (p!=0) { A[p-1][rIdx] = 1; A[rIdx][p-1] = 1; }
+            if (n!=0) { A[n-1][rIdx] = -1; A[rIdx][n-1] = -1; }
+            B[rIdx] = comp->value;
+            vSourceIndex++;
+        }
+    }
+}
+
+
+// 4. Fixed-size Dense Solver (tiny circuits)
+
+
+// Largest MNA system solve() hands to the fixed-size kernel
+const int FIXED_SIZE_LIMIT = 16;
+
+// Helper: abs() usable in constant expressions (std::abs is not constexpr
+// before C++23)
+constexpr double constexprAbs(double x) { return x < 0 ? -x : x; }
+
+// gaussianElimination() for an N x N system held in std::array. Every trip
+// count is a compile-time constant, so the loops unroll and the system
+// stays on the stack. Same pivoting, tolerance and error message; rows with
+// a zero below the pivot are skipped, the rest are the same operations in
+// the same order, so the results compare equal to the generic routine's.
+// constexpr so StaticCircuit can solve at compile time; a singular system
+// there is a compile error.
+template<size_t N>
+constexpr array<double, N> fixedGaussianElimination(array<array<double, N>, N> A, array<double, N> B) {
+    const double EPSILON = 1e-9;
+    for (size_t i = 0; i < N; i++) {
+        double maxEl = constexprAbs(A[i][i]);
+        size_t maxRow = i;
+        for (size_t k = i + 1; k < N; k++) {
+            if (constexprAbs(A[k][i]) > maxEl) {
+                maxEl = constexprAbs(A[k][i]);
+                maxRow = k;
+            }
+        }
+        if (maxRow != i) { // std::swap is not constexpr in C++17
+            for (size_t j = 0; j < N; j++) {
+                double t = A[maxRow][j];
+                A[maxRow][j] = A[i][j];
+                A[i][j] = t;
+            }
+            double t = B[maxRow];
+            B[maxRow] = B[i];
+            B[i] = t;
+        }
+
+        if (constexprAbs(A[i][i]) < EPSILON) {
+            throw runtime_error(SINGULAR_MESSAGE);
+        }
+
+        for (size_t k = i + 1; k < N; k++) {
+            if (A[k][i] == 0.0) continue; // MNA rows are mostly zeros
+            double factor = A[k][i] / A[i][i];
+            B[k] -= factor * B[i];
+            for (size_t j = i; j < N; j++) {
+                A[k][j] -= factor * A[i][j];
+            }
+        }
+    }
+
+    array<double, N> x{};
+    for (size_t i = N; i-- > 0;) {
+        double sum = 0;
+        for (size_t j = i + 1; j < N; j++) {
+            sum += A[i][j] * x[j];
+        }
+        x[i] = (B[i] - sum) / A[i][i];
+    }
+    return x;
+}
+
+// Stamps the MNA system of a circuit with matrixSize (1..FIXED_SIZE_LIMIT)
+// unknowns into std::arrays and solves it with the kernel for that size.
+// Writes voltages[1..nodeCount] (voltages must already have that size).
+void solveFixedMNA(const Circuit& circuit, int matrixSize, vector<double>& voltages);
+
 #endif // CIRCUIT_SOLVER_H
\ No newline at end of file
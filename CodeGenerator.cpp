@@ -0,0 +1,281 @@
+#include "CodeGenerator.h"
+#include "SparseSolver.h"
+#include <sstream>
+#include <fstream>
+#include <filesystem>
+#include <cerrno>
+#include <cstdlib>
+#include <stdexcept>
+#if defined(__unix__) || defined(__APPLE__)
+#include <dlfcn.h>
+#include <spawn.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#define CIRCUIT_HAVE_DLOPEN 1
+extern char** environ;
+#endif
+
+using namespace std;
+
+
+// generateSolverSource() - BatchSolve's Plan as Straight-line Code
+
+string generateSolverSource(const Circuit& circuit, const string& functionName) {
+    BatchSolve plan(circuit, 1); // Validates the circuit like PreparedSolve
+    int n = plan.unknowns, nodes = plan.nodes;
+    long long entries = (long long)plan.entryRow.size();
+
+    // Only nodes on the voltage-source forest have an offset
+    vector<char> hasOffset(nodes, 0);
+    for (const auto& step : plan.offsetWalk) hasOffset[step.node] = 1;
+    auto offsetOf = [&](int node) { return hasOffset[node] ? "o[" + to_string(node) + "]" : string(); };
+
+    ostringstream out;
+    out << "// Generated by CircuitSolver for one fixed topology: " << plan.componentCount() << " components, "
+        << nodes << " nodes, " << n << " unknowns, " << entries << " nonzeros in L, "
+        << plan.updates.size() << " updates.\n"
+        << "// values[c]: component c in Circuit::getComponents() order; voltages[i]: node ID i.\n"
+        << "// Returns 0, or 1 if the matrix is singular (voltages are then undefined).\n"
+        << "extern \"C\" double sqrt(double); // <cmath> alone doubles the build time\n\n"
+        << "extern \"C\" int " << functionName << "(const double* v, double* voltages) {\n"
+        << "    double o[" << max(1, nodes) << "] = {};\n"
+        << "    double L[" << max(1LL, entries) << "] = {};\n"
+        << "    double y[" << max(1, n) << "] = {};\n"
+        << "    double r[" << max(1, n) << "];\n"
+        << "    int ok = 1;\n";
+
+    out << "\n    // Node offsets along the voltage-source forest\n";
+    for (const auto& step : plan.offsetWalk) {
+        out << "    o[" << step.node << "] = ";
+        string parent = offsetOf(step.parent);
+        if (!parent.empty()) out << parent << (step.sign > 0 ? " + " : " - ");
+        else if (step.sign < 0) out << "-";
+        out << "v[" << step.source << "];\n";
+    }
+
+    out << "\n    // Stamps\n";
+    for (size_t c = 0; c < plan.stamps.size(); c++) {
+        const BatchSolve::Stamp& st = plan.stamps[c];
+        if (st.type == RESISTOR) {
+            if (st.ra >= 0 && st.ra == st.rb) continue;
+            if (st.ra < 0 && st.rb < 0) continue;
+            string oa = offsetOf(st.nodeA), ob = offsetOf(st.nodeB);
+            string drop; // V(nodeA) - V(nodeB) carried by the offsets
+            if (!oa.empty() && !ob.empty()) drop = "(" + oa + " - " + ob + ")";
+            else if (!oa.empty()) drop = oa;
+            else if (!ob.empty()) drop = "(-" + ob + ")";
+            out << "    { const double g = 1.0 / v[" << c << "];";
+            if (st.ra >= 0) {
+                out << " L[" << st.aa << "] += g;";
+                if (!drop.empty()) out << " y[" << st.ra << "] -= g * " << drop << ";";
+            }
+            if (st.rb >= 0) {
+                out << " L[" << st.bb << "] += g;";
+                if (!drop.empty()) out << " y[" << st.rb << "] += g * " << drop << ";";
+            }
+            if (st.ab >= 0) out << " L[" << st.ab << "] -= g;";
+            out << " }\n";
+        } else if (st.type == CURRENT_SOURCE) {
+            if (st.ra >= 0) out << "    y[" << st.ra << "] -= v[" << c << "];\n";
+            if (st.rb >= 0) out << "    y[" << st.rb << "] += v[" << c << "];\n";
+        }
+    }
+
+    out << "\n    // Cholesky factorization, column by column\n";
+    for (int j = 0; j < n; j++) {
+        int d = plan.colPtr[j];
+        out << "    { const double t = 1e-12 * L[" << d << "];\n";
+        for (int u = plan.updatePtr[j]; u < plan.updatePtr[j + 1]; u++) {
+            const BatchSolve::Update& up = plan.updates[u];
+            out << "      L[" << up.target << "] -= L[" << up.source << "] * L[" << up.multiplier << "];\n";
+        }
+        out << "      ok &= L[" << d << "] > t; L[" << d << "] = sqrt(L[" << d << "]); r[" << j << "] = 1.0 / L[" << d << "];";
+        for (int e = d + 1; e < plan.colPtr[j + 1]; e++) out << " L[" << e << "] *= r[" << j << "];";
+        out << " }\n";
+    }
+
+    out << "\n    // Forward and backward substitution\n";
+    for (int j = 0; j < n; j++) {
+        out << "    y[" << j << "] *= r[" << j << "];";
+        for (int e = plan.colPtr[j] + 1; e < plan.colPtr[j + 1]; e++) {
+            out << " y[" << plan.entryRow[e] << "] -= L[" << e << "] * y[" << j << "];";
+        }
+        out << "\n";
+    }
+    for (int j = n - 1; j >= 0; j--) {
+        out << "   ";
+        for (int e = plan.colPtr[j] + 1; e < plan.colPtr[j + 1]; e++) {
+            out << " y[" << j << "] -= L[" << e << "] * y[" << plan.entryRow[e] << "];";
+        }
+        out << " y[" << j << "] *= r[" << j << "];\n";
+    }
+
+    out << "\n    // Node voltages\n";
+    for (int i = 0; i < nodes; i++) {
+        int r = plan.nodeRow[i];
+        string offset = offsetOf(i);
+        out << "    voltages[" << i << "] = ";
+        if (r >= 0 && !offset.empty()) out << "y[" << r << "] + " << offset;
+        else if (r >= 0) out << "y[" << r << "]";
+        else if (!offset.empty()) out << offset;
+        else out << "0.0";
+        out << ";\n";
+    }
+    out << "    return !ok;\n}\n";
+    return out.str();
+}
+
+
+// GeneratedSolver Constructor - Emit, Compile, Load or Fall Back
+
+static const char* const GENERATED_SYMBOL = "circuit_generated_solve";
+
+GeneratedSolver::GeneratedSolver(const Circuit& circuit, const CodeGenOptions& options) {
+    BatchSolve plan(circuit, 1); // Throws for circuits solve() rejects
+    for (const auto& comp : circuit.getComponents()) {
+        values.push_back(comp->value);
+        names.push_back(comp->name);
+        types.push_back(comp->getType());
+    }
+    nodeVoltages.assign(plan.nodes, 0.0);
+
+    try {
+        if ((long long)plan.updates.size() > options.maxOperations) {
+            throw runtime_error("plan has " + to_string(plan.updates.size()) + " updates, more than maxOperations");
+        }
+        load(generateSolverSource(circuit, GENERATED_SYMBOL), options);
+    } catch (const exception& e) {
+        reason = e.what();
+    }
+    if (!function) fallback = make_unique<PreparedSolve>(circuit);
+}
+
+GeneratedSolver::~GeneratedSolver() {
+#ifdef CIRCUIT_HAVE_DLOPEN
+    if (library) dlclose(library);
+#endif
+}
+
+#ifdef CIRCUIT_HAVE_DLOPEN
+// Helper: words of a compiler or flags string, split on whitespace (no
+// shell is involved, so quotes and metacharacters have no meaning)
+static vector<string> splitWords(const string& text) {
+    istringstream in(text);
+    vector<string> words;
+    string word;
+    while (in >> word) words.push_back(word);
+    return words;
+}
+
+// Helper: run args[0] (searched in PATH) with stdout and stderr sent to
+// logPath; its exit status, or -1 if it could not be started
+static int runCommand(const vector<string>& args, const string& logPath) {
+    vector<char*> argv;
+    for (const string& a : args) argv.push_back(const_cast<char*>(a.c_str()));
+    argv.push_back(nullptr);
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, logPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    posix_spawn_file_actions_adddup2(&actions, STDOUT_FILENO, STDERR_FILENO);
+    pid_t pid;
+    int error = posix_spawnp(&pid, argv[0], &actions, nullptr, argv.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    if (error != 0) return -1;
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) return -1;
+    }
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+#endif
+
+void GeneratedSolver::load(const string& source, const CodeGenOptions& options) {
+#ifdef CIRCUIT_HAVE_DLOPEN
+    // A private directory (mode 0700) with an unpredictable name, so no
+    // other user can plant or swap the files between writing and dlopen
+    string dir = options.workDirectory.empty() ? filesystem::temp_directory_path().string() : options.workDirectory;
+    string pattern = (filesystem::path(dir) / "circuit_solver_XXXXXX").string();
+    vector<char> buffer(pattern.begin(), pattern.end());
+    buffer.push_back('\0');
+    if (!mkdtemp(buffer.data())) throw runtime_error("cannot create a private directory in " + dir);
+    filesystem::path privateDir(buffer.data());
+    string sourcePath = (privateDir / "solver.cpp").string();
+    string libraryPath = (privateDir / "solver.so").string();
+    string logPath = (privateDir / "compile.log").string();
+
+    // Removes the directory on every path out; a loaded library stays mapped
+    struct Cleanup {
+        filesystem::path dir;
+        ~Cleanup() { error_code ec; filesystem::remove_all(dir, ec); }
+    } cleanup{privateDir};
+
+    {
+        ofstream file(sourcePath);
+        file << source;
+        if (!file) throw runtime_error("cannot write " + sourcePath);
+    }
+    string compiler = options.compiler;
+    if (compiler.empty()) {
+        const char* cxx = getenv("CXX");
+        compiler = (cxx && *cxx) ? cxx : "c++";
+    }
+    // Run directly, not through a shell: $CXX may name a launcher and a
+    // compiler ("ccache g++"), but cannot inject commands
+    vector<string> args = splitWords(compiler);
+    if (args.empty()) throw runtime_error("no compiler given");
+    for (const string& flag : splitWords(options.flags)) args.push_back(flag);
+    for (const char* arg : {"-shared", "-fPIC", "-o"}) args.push_back(arg);
+    args.push_back(libraryPath);
+    args.push_back(sourcePath);
+    int exitCode = runCommand(args, logPath);
+    if (exitCode != 0) {
+        ifstream log(logPath);
+        string firstLine;
+        getline(log, firstLine);
+        throw runtime_error("compiling with '" + compiler + "' failed (" +
+                            (exitCode < 0 ? string("could not run it") : "status " + to_string(exitCode)) + ")" +
+                            (firstLine.empty() ? string() : ": " + firstLine));
+    }
+
+    library = dlopen(libraryPath.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (!library) {
+        const char* error = dlerror();
+        throw runtime_error(string("dlopen failed: ") + (error ? error : "unknown error"));
+    }
+    function = reinterpret_cast<SolveFunction>(dlsym(library, GENERATED_SYMBOL));
+    if (!function) throw runtime_error("generated library has no solve function");
+#else
+    (void)source;
+    (void)options;
+    throw runtime_error("loading generated code is not supported on this platform");
+#endif
+}
+
+
+// GeneratedSolver Value Access and Solve
+
+int GeneratedSolver::componentIndex(const string& name) const {
+    for (size_t c = 0; c < names.size(); c++) {
+        if (names[c] == name) return (int)c;
+    }
+    return -1;
+}
+
+void GeneratedSolver::setValue(int index, double value) {
+    if (index < 0 || index >= (int)values.size()) {
+        throw invalid_argument("Error: Component index out of range.");
+    }
+    if (types[index] == RESISTOR && value <= 0) throw invalid_argument("Error: Resistance must be positive.");
+    values[index] = value;
+    if (fallback) fallback->setValue(index, value);
+}
+
+void GeneratedSolver::solve() {
+    if (fallback) {
+        fallback->solve();
+        nodeVoltages = fallback->voltages();
+        return;
+    }
+    if (function(values.data(), nodeVoltages.data()) != 0) throw runtime_error(SINGULAR_MESSAGE);
+}
@@ -0,0 +1,85 @@
+#ifndef CODE_GENERATOR_H
+#define CODE_GENERATOR_H
+
+#include <vector>
+#include <string>
+#include <memory>
+#include "CircuitSolver.h"
+#include "PreparedSolve.h"
+
+using namespace std;
+
+
+// 1. Straight-line Solver Source
+
+
+// C++ source of one function that solves the circuit's topology for any
+// component values:
+//
+//     extern "C" int <functionName>(const double* values, double* voltages)
+//
+// values[c] is component c in Circuit::getComponents() order, voltages[i]
+// is node ID i (0 = ground). Returns 0, or 1 if the matrix is singular.
+// The body is BatchSolve's factorization plan unrolled: every stamp,
+// update and substitution is one statement with constant indices, with no
+// loops or branches. Throws like PreparedSolve's constructor.
+string generateSolverSource(const Circuit& circuit, const string& functionName = "circuit_generated_solve");
+
+
+// 2. Compiled and Loaded Solver
+
+
+struct CodeGenOptions {
+    string compiler;                 // Empty: $CXX, or "c++" if unset
+    string flags = "-O2";            // Split on whitespace; compiler and flags never go through a shell
+    string workDirectory;            // Holds a private directory for source and library; empty = system temp dir
+    long long maxOperations = 1000; // Larger plans are not compiled: they build slowly and run slower than PreparedSolve
+};
+
+// Solves a fixed topology with a function generated for it: the source is
+// written, compiled into a shared library with the local compiler and
+// loaded with dlopen (the files are removed once loaded). When any step is
+// unavailable or fails, solve() uses PreparedSolve instead and
+// fallbackReason() says why, so callers never need a compiler.
+class GeneratedSolver {
+private:
+    typedef int (*SolveFunction)(const double*, double*);
+
+    vector<double> values;      // Per component, in Circuit::getComponents() order
+    vector<string> names;
+    vector<ComponentType> types;
+    vector<double> nodeVoltages;
+
+    void* library = nullptr;
+    SolveFunction function = nullptr;
+    string reason;
+    unique_ptr<PreparedSolve> fallback;
+
+    void load(const string& source, const CodeGenOptions& options);
+
+public:
+    // Throws runtime_error for the circuits Circuit::solve() rejects
+    explicit GeneratedSolver(const Circuit& circuit, const CodeGenOptions& options = CodeGenOptions());
+    ~GeneratedSolver();
+    GeneratedSolver(const GeneratedSolver&) = delete; // Owns the loaded library
+    GeneratedSolver& operator=(const GeneratedSolver&) = delete;
+
+    bool usesGeneratedCode() const { return function != nullptr; }
+    const string& fallbackReason() const { return reason; }
+
+    int componentCount() const { return (int)values.size(); }
+    int componentIndex(const string& name) const; // -1 if there is no such component
+    double getValue(int index) const { return values.at(index); }
+
+    // Throws invalid_argument for a bad index or a non-positive resistance
+    void setValue(int index, double value);
+
+    // Throws runtime_error if the values make the matrix singular
+    void solve();
+
+    // Results of the last solve(), indexed by node ID (index 0 = ground)
+    const vector<double>& voltages() const { return nodeVoltages; }
+    void applyTo(Circuit& circuit) const { circuit.applyVoltages(nodeVoltages); }
+};
+
+#endif // CODE_GENERATOR_H
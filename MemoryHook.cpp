@@ -0,0 +1,77 @@
+#include "MemoryTracker.h"
+#include <new>
+#include <cstdlib>
+
+// The counting operator new. It is linked into an executable directly (see
+// CIRCUIT_MEMORY_HOOK in CMakeLists.txt), never through the library, so
+// only the targets that measure memory pay for it.
+
+
+// Registration
+// Runs during static initialization; memoryHookInstalled() is true from then on.
+
+static struct MemoryHookRegistration {
+    MemoryHookRegistration() { registerMemoryHook(); }
+} memoryHookRegistration;
+
+
+// Global operator new / delete Replacement
+// Each block carries a 16-byte header (size and subsystem) in front of
+// the pointer handed out, which keeps malloc's 16-byte alignment. The
+// over-aligned (align_val_t) forms are left to the runtime and not counted.
+
+struct AllocationHeader {
+    size_t size;
+    int subsystem; // -1: allocated while tracking was off
+};
+const size_t ALLOCATION_HEADER_BYTES = 16;
+static_assert(sizeof(AllocationHeader) <= ALLOCATION_HEADER_BYTES, "header must fit in front of the block");
+
+static void* trackedAllocate(size_t size) {
+    if (size == 0) size = 1;
+    if (size > (size_t)-1 - ALLOCATION_HEADER_BYTES) return nullptr;
+    while (true) {
+        void* raw = malloc(size + ALLOCATION_HEADER_BYTES);
+        if (raw) {
+            AllocationHeader* header = static_cast<AllocationHeader*>(raw);
+            header->size = size;
+            header->subsystem = -1;
+            if (memoryTrackingEnabled()) {
+                header->subsystem = currentMemorySubsystem;
+                chargeMemory(currentMemorySubsystem, (long long)size);
+            }
+            return static_cast<char*>(raw) + ALLOCATION_HEADER_BYTES;
+        }
+        new_handler handler = get_new_handler();
+        if (!handler) return nullptr;
+        handler();
+    }
+}
+
+static void trackedFree(void* p) {
+    if (!p) return;
+    void* raw = static_cast<char*>(p) - ALLOCATION_HEADER_BYTES;
+    const AllocationHeader* header = static_cast<const AllocationHeader*>(raw);
+    if (header->subsystem >= 0) chargeMemory((MemorySubsystem)header->subsystem, -(long long)header->size);
+    free(raw);
+}
+
+void* operator new(size_t size) {
+    void* p = trackedAllocate(size);
+    if (!p) throw bad_alloc();
+    return p;
+}
+void* operator new[](size_t size) {
+    void* p = trackedAllocate(size);
+    if (!p) throw bad_alloc();
+    return p;
+}
+void* operator new(size_t size, const nothrow_t&) noexcept { return trackedAllocate(size); }
+void* operator new[](size_t size, const nothrow_t&) noexcept { return trackedAllocate(size); }
+
+void operator delete(void* p) noexcept { trackedFree(p); }
+void operator delete[](void* p) noexcept { trackedFree(p); }
+void operator delete(void* p, size_t) noexcept { trackedFree(p); }
+void operator delete[](void* p, size_t) noexcept { trackedFree(p); }
+void operator delete(void* p, const nothrow_t&) noexcept { trackedFree(p); }
+void operator delete[](void* p, const nothrow_t&) noexcept { trackedFree(p); }
@@ -0,0 +1,125 @@
+#include "MemoryTracker.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+thread_local MemorySubsystem currentMemorySubsystem = MEM_OTHER;
+
+
+// Helper: Subsystem Names (also the JSON keys)
+
+const char* memorySubsystemName(MemorySubsystem subsystem) {
+    switch (subsystem) {
+        case MEM_OTHER: return "other";
+        case MEM_COMPONENTS: return "components";
+        case MEM_NAME_TABLE: return "name_table";
+        case MEM_MATRIX: return "matrix";
+        case MEM_FACTORS: return "factors";
+        case MEM_RESULTS: return "results";
+        case MEM_SUBSYSTEM_COUNT: break;
+    }
+    return "unknown";
+}
+
+
+// Helper: Counters
+// Plain atomics with constant initialization, so the hook works before
+// main() and never allocates itself.
+
+struct SubsystemCounters {
+    atomic<long long> current{0};
+    atomic<long long> peak{0};
+    atomic<long long> allocated{0};
+    atomic<long long> allocations{0};
+};
+
+static atomic<bool> trackingOn{false};
+static SubsystemCounters counters[MEM_SUBSYSTEM_COUNT];
+static atomic<long long> heapCurrent{0};
+static atomic<long long> heapPeak{0};
+static atomic<long long> phasePeak{0};
+
+
+// Tracking Control
+
+void enableMemoryTracking(bool on) { trackingOn.store(on); }
+
+bool memoryTrackingEnabled() { return trackingOn.load(memory_order_relaxed); }
+
+MemorySnapshot memorySnapshot() {
+    MemorySnapshot snap;
+    for (int s = 0; s < MEM_SUBSYSTEM_COUNT; s++) {
+        snap.subsystems[s].currentBytes = counters[s].current.load();
+        snap.subsystems[s].peakBytes = counters[s].peak.load();
+        snap.subsystems[s].allocatedBytes = counters[s].allocated.load();
+        snap.subsystems[s].allocations = counters[s].allocations.load();
+    }
+    snap.heapBytes = heapCurrent.load();
+    snap.heapPeakBytes = heapPeak.load();
+    return snap;
+}
+
+
+// Per-phase Peaks and RSS (Linux /proc; zero elsewhere)
+
+// Helper: one "Key:   123 kB" line of /proc/self/status, in bytes
+static long long procStatusBytes(const char* key) {
+    FILE* f = fopen("/proc/self/status", "r");
+    if (!f) return 0;
+    char line[256];
+    long long kb = 0;
+    size_t keyLength = strlen(key);
+    while (fgets(line, sizeof(line), f)) {
+        if (strncmp(line, key, keyLength) == 0 && line[keyLength] == ':') {
+            kb = atoll(line + keyLength + 1);
+            break;
+        }
+    }
+    fclose(f);
+    return kb * 1024;
+}
+
+void beginMemoryPhase() {
+    phasePeak.store(heapCurrent.load());
+    // "5" resets VmHWM to the current RSS (Linux 4.0+)
+    if (FILE* f = fopen("/proc/self/clear_refs", "w")) {
+        fputs("5", f);
+        fclose(f);
+    }
+}
+
+long long phaseHeapPeakBytes() { return phasePeak.load(); }
+
+long long peakRssBytes() { return procStatusBytes("VmHWM"); }
+
+long long currentRssBytes() { return procStatusBytes("VmRSS"); }
+
+
+// Hook Registration and Charging
+
+
+static atomic<bool> hookRegistered{false};
+
+void registerMemoryHook() { hookRegistered.store(true); }
+
+bool memoryHookInstalled() { return hookRegistered.load(); }
+
+// Helper: raise a peak counter without locks
+static void raiseTo(atomic<long long>& peak, long long value) {
+    long long seen = peak.load(memory_order_relaxed);
+    while (value > seen && !peak.compare_exchange_weak(seen, value, memory_order_relaxed)) {}
+}
+
+void chargeMemory(MemorySubsystem subsystem, long long bytes) {
+    SubsystemCounters& c = counters[subsystem];
+    long long now = c.current.fetch_add(bytes, memory_order_relaxed) + bytes;
+    long long heap = heapCurrent.fetch_add(bytes, memory_order_relaxed) + bytes;
+    if (bytes > 0) {
+        c.allocated.fetch_add(bytes, memory_order_relaxed);
+        c.allocations.fetch_add(1, memory_order_relaxed);
+        raiseTo(c.peak, now);
+        raiseTo(heapPeak, heap);
+        raiseTo(phasePeak, heap);
+    }
+}
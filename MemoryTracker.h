@@ -0,0 +1,78 @@
+#ifndef MEMORY_TRACKER_H
+#define MEMORY_TRACKER_H
+
+#include <cstddef>
+
+using namespace std;
+
+
+// 1. Memory Accounting (counting operator new hook)
+
+
+// Where heap memory is charged. The subsystem is a per-thread tag set by
+// MemoryScope; every allocation remembers the tag it was made under, so a
+// block freed later (or on another thread) is credited back correctly.
+enum MemorySubsystem {
+    MEM_OTHER,      // Untagged: parser buffers, output strings, callers' data
+    MEM_COMPONENTS, // Component objects and the component list
+    MEM_NAME_TABLE, // Node name -> ID map
+    MEM_MATRIX,     // MNA / reduced nodal matrices and right-hand sides
+    MEM_FACTORS,    // Orderings, factors, preconditioners and solver workspace
+    MEM_RESULTS,    // Node voltages
+    MEM_SUBSYSTEM_COUNT
+};
+
+const char* memorySubsystemName(MemorySubsystem subsystem);
+
+struct SubsystemMemory {
+    long long currentBytes = 0;   // Live now
+    long long peakBytes = 0;      // Highest live total since tracking began
+    long long allocatedBytes = 0; // Sum of all allocations (churn)
+    long long allocations = 0;
+};
+
+struct MemorySnapshot {
+    SubsystemMemory subsystems[MEM_SUBSYSTEM_COUNT];
+    long long heapBytes = 0;     // Live tracked heap, all subsystems
+    long long heapPeakBytes = 0;
+};
+
+// False when the executable was linked without the counting operator new
+// (MemoryHook.cpp, see CIRCUIT_MEMORY_HOOK); then only the RSS figures
+// below are available.
+bool memoryHookInstalled();
+
+// Called by the counting operator new only
+void registerMemoryHook();
+void chargeMemory(MemorySubsystem subsystem, long long bytes);
+
+// Accounting is process-wide (the hook replaces the global operator new).
+// Blocks allocated while it was off are never counted, even when freed.
+void enableMemoryTracking(bool on = true);
+bool memoryTrackingEnabled();
+MemorySnapshot memorySnapshot();
+
+// Per-phase peaks: beginMemoryPhase() restarts the heap peak and, where
+// the kernel allows it (/proc/self/clear_refs), the RSS high-water mark.
+void beginMemoryPhase();
+long long phaseHeapPeakBytes();
+long long peakRssBytes();    // VmHWM, 0 where unsupported
+long long currentRssBytes(); // VmRSS, 0 where unsupported
+
+extern thread_local MemorySubsystem currentMemorySubsystem;
+
+// Charges the allocations of its scope (on this thread) to one subsystem
+class MemoryScope {
+private:
+    MemorySubsystem previous;
+
+public:
+    explicit MemoryScope(MemorySubsystem subsystem) : previous(currentMemorySubsystem) {
+        currentMemorySubsystem = subsystem;
+    }
+    ~MemoryScope() { currentMemorySubsystem = previous; }
+    MemoryScope(const MemoryScope&) = delete;
+    MemoryScope& operator=(const MemoryScope&) = delete;
+};
+
+#endif // MEMORY_TRACKER_H
@@ -0,0 +1,90 @@
+#include "PerfCounters.h"
+#include <cstring>
+#include <cerrno>
+#include <cstdint>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+
+// Helper: Event Names (also the JSON keys)
+
+const char* hardwareEventName(HardwareEvent event) {
+    switch (event) {
+        case HW_CYCLES: return "cycles";
+        case HW_INSTRUCTIONS: return "instructions";
+        case HW_CACHE_REFERENCES: return "llc_references";
+        case HW_CACHE_MISSES: return "llc_misses";
+        case HW_BRANCHES: return "branches";
+        case HW_BRANCH_MISSES: return "branch_misses";
+        case HW_EVENT_COUNT: break;
+    }
+    return "unknown";
+}
+
+
+// PerfCounters Implementation
+
+#ifdef __linux__
+
+PerfCounters::PerfCounters() {
+    const uint64_t configs[HW_EVENT_COUNT] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_REFERENCES, PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_BRANCH_INSTRUCTIONS, PERF_COUNT_HW_BRANCH_MISSES};
+
+    // Separate (ungrouped) events: if the CPU has fewer counters than
+    // events the kernel multiplexes them and read() scales the counts
+    for (int e = 0; e < HW_EVENT_COUNT; e++) {
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = configs[e];
+        attr.exclude_kernel = 1; // Allowed at the default perf_event_paranoid level
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        fds[e] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        if (fds[e] < 0 && reason.empty()) {
+            reason = string("perf_event_open(") + hardwareEventName((HardwareEvent)e) + "): " + strerror(errno);
+        }
+    }
+    if (available()) reason.clear();
+}
+
+PerfCounters::~PerfCounters() {
+    for (int fd : fds) if (fd >= 0) close(fd);
+}
+
+bool PerfCounters::available() const {
+    return fds[HW_CYCLES] >= 0 && fds[HW_INSTRUCTIONS] >= 0;
+}
+
+CounterSample PerfCounters::read() const {
+    CounterSample sample;
+    for (int e = 0; e < HW_EVENT_COUNT; e++) {
+        if (fds[e] < 0) continue;
+        uint64_t data[3]; // value, time enabled, time running
+        if (::read(fds[e], data, sizeof(data)) != (ssize_t)sizeof(data) || data[2] == 0) continue;
+        sample.value[e] = (double)data[0] * ((double)data[1] / (double)data[2]);
+        sample.valid[e] = true;
+    }
+    return sample;
+}
+
+#else
+
+PerfCounters::PerfCounters() : reason("hardware counters need Linux perf_event") {
+    for (int& fd : fds) fd = -1;
+}
+
+PerfCounters::~PerfCounters() {}
+
+bool PerfCounters::available() const { return false; }
+
+CounterSample PerfCounters::read() const { return CounterSample(); }
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <string>
+
+using namespace std;
+
+
+// 1. Hardware Performance Counters (Linux perf_event)
+
+
+enum HardwareEvent {
+    HW_CYCLES,
+    HW_INSTRUCTIONS,
+    HW_CACHE_REFERENCES, // Last-level cache accesses
+    HW_CACHE_MISSES,     // Last-level cache misses
+    HW_BRANCHES,
+    HW_BRANCH_MISSES,
+    HW_EVENT_COUNT
+};
+
+const char* hardwareEventName(HardwareEvent event);
+
+// Counter values at one point in time, scaled up when the kernel had to
+// multiplex the counters. valid[e] is false for events this CPU (or VM)
+// does not expose.
+struct CounterSample {
+    double value[HW_EVENT_COUNT] = {};
+    bool valid[HW_EVENT_COUNT] = {};
+};
+
+// Counts user-space events of the thread that created it. Opening never
+// throws: when perf_event_open is missing, forbidden (perf_event_paranoid,
+// containers) or not on Linux, available() is false and read() returns
+// samples with no valid events.
+class PerfCounters {
+private:
+    int fds[HW_EVENT_COUNT];
+    string reason; // Why counters are unavailable
+
+public:
+    PerfCounters();
+    ~PerfCounters();
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool available() const; // At least cycles and instructions work
+    const string& unavailableReason() const { return reason; }
+
+    CounterSample read() const;
+};
+
+#endif // PERF_COUNTERS_H
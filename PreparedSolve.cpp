@@ -0,0 +1,415 @@
+#include "PreparedSolve.h"
+#include <algorithm>
+#include <stdexcept>
+#include <cmath>
+
+using namespace std;
+
+
+// Helper: position of entry (row, col) in a CSC matrix, -1 if absent
+
+static int entryPosition(const SparseMatrix& A, int row, int col) {
+    auto first = A.rowIdx.begin() + A.colPtr[col];
+    auto last = A.rowIdx.begin() + A.colPtr[col + 1];
+    auto it = lower_bound(first, last, row);
+    if (it == last || *it != row) return -1;
+    return (int)(it - A.rowIdx.begin());
+}
+
+
+// PreparedSolve Constructor - Topology Work Done Once
+
+PreparedSolve::PreparedSolve(const Circuit& circuit) {
+    circuit.checkSolvable();
+    sys = buildNodalSystem(circuit); // Throws on voltage-source loops
+    if (sys.floatingGroups > 0) throw runtime_error(SINGULAR_MESSAGE);
+    nodes = (int)sys.nodeToUnknown.size();
+
+    const auto& components = circuit.getComponents();
+    int count = (int)components.size();
+    values.reserve(count);
+    names.reserve(count);
+    stamps.reserve(count);
+    for (const auto& comp : components) {
+        values.push_back(comp->value);
+        names.push_back(comp->name);
+        Stamp st;
+        st.type = comp->getType();
+        st.nodeA = comp->nodeA_ID;
+        st.nodeB = comp->nodeB_ID;
+        st.ua = sys.nodeToUnknown[st.nodeA];
+        st.ub = sys.nodeToUnknown[st.nodeB];
+        if (st.type == RESISTOR && !(st.ua >= 0 && st.ua == st.ub)) {
+            if (st.ua >= 0) st.aa = entryPosition(sys.A, st.ua, st.ua);
+            if (st.ub >= 0) st.bb = entryPosition(sys.A, st.ub, st.ub);
+            if (st.ua >= 0 && st.ub >= 0) {
+                st.ab = entryPosition(sys.A, st.ua, st.ub);
+                st.ba = entryPosition(sys.A, st.ub, st.ua);
+            }
+        }
+        stamps.push_back(st);
+    }
+
+    // Walk the voltage-source forest from a fixed root per tree (ground for
+    // its own tree), so offsets can be recomputed without union-find. Any
+    // root gives the same voltages; ground's tree must start at ground.
+    vector<vector<int>> incident(nodes);
+    for (int c = 0; c < count; c++) {
+        if (stamps[c].type != VOLTAGE_SOURCE) continue;
+        incident[stamps[c].nodeA].push_back(c);
+        incident[stamps[c].nodeB].push_back(c);
+    }
+    vector<char> reached(nodes, 0);
+    vector<int> queue;
+    for (int root = 0; root < nodes; root++) {
+        if (reached[root] || incident[root].empty()) continue;
+        reached[root] = 1;
+        queue.assign(1, root);
+        for (size_t q = 0; q < queue.size(); q++) {
+            int v = queue[q];
+            for (int c : incident[v]) {
+                const Stamp& st = stamps[c];
+                int other = (st.nodeA == v) ? st.nodeB : st.nodeA;
+                if (reached[other]) continue;
+                reached[other] = 1;
+                // V(nodeA) - V(nodeB) = value
+                offsetWalk.push_back({other, v, c, other == st.nodeA ? 1.0 : -1.0});
+                queue.push_back(other);
+            }
+        }
+    }
+
+    // Symbolic work and every workspace, sized for this pattern
+    {
+        MemoryScope memory(MEM_FACTORS);
+        SymbolicFactor sym = symbolicAnalysis(sys.A, minimumDegreeOrdering(sys.A));
+        chol.analyze(sys.A, sym);
+        x.assign(sys.unknowns, 0.0);
+        work.assign(sys.unknowns, 0.0);
+    }
+    MemoryScope memory(MEM_RESULTS);
+    nodeVoltages.assign(nodes, 0.0);
+}
+
+
+// Value Access
+
+int PreparedSolve::componentIndex(const string& name) const {
+    for (size_t c = 0; c < names.size(); c++) {
+        if (names[c] == name) return (int)c;
+    }
+    return -1;
+}
+
+void PreparedSolve::setValue(int index, double value) {
+    if (index < 0 || index >= (int)values.size()) {
+        throw invalid_argument("Error: Component index out of range.");
+    }
+    if (stamps[index].type == RESISTOR) {
+        if (value <= 0) throw invalid_argument("Error: Resistance must be positive.");
+        if (value != values[index]) factorValid = false;
+    }
+    values[index] = value;
+}
+
+
+// Helper: Restamping into the Fixed Pattern
+
+void PreparedSolve::restampMatrix() {
+    fill(sys.A.values.begin(), sys.A.values.end(), 0.0);
+    for (size_t c = 0; c < stamps.size(); c++) {
+        const Stamp& st = stamps[c];
+        if (st.type != RESISTOR) continue;
+        double g = 1.0 / values[c];
+        if (st.aa >= 0) sys.A.values[st.aa] += g;
+        if (st.bb >= 0) sys.A.values[st.bb] += g;
+        if (st.ab >= 0) sys.A.values[st.ab] -= g;
+        if (st.ba >= 0) sys.A.values[st.ba] -= g;
+    }
+}
+
+void PreparedSolve::restampRhs() {
+    // Source voltages may have changed, so refresh the fixed offsets first
+    for (const OffsetStep& step : offsetWalk) {
+        sys.nodeOffset[step.node] = sys.nodeOffset[step.parent] + step.sign * values[step.source];
+    }
+    fill(sys.b.begin(), sys.b.end(), 0.0);
+    for (size_t c = 0; c < stamps.size(); c++) {
+        const Stamp& st = stamps[c];
+        if (st.type == RESISTOR) {
+            if (st.ua >= 0 && st.ua == st.ub) continue;
+            double g = 1.0 / values[c];
+            double oa = sys.nodeOffset[st.nodeA], ob = sys.nodeOffset[st.nodeB];
+            if (st.ua >= 0) sys.b[st.ua] -= g * (oa - ob);
+            if (st.ub >= 0) sys.b[st.ub] -= g * (ob - oa);
+        }
+        else if (st.type == CURRENT_SOURCE) {
+            if (st.ua >= 0) sys.b[st.ua] -= values[c];
+            if (st.ub >= 0) sys.b[st.ub] += values[c];
+        }
+    }
+}
+
+
+// PreparedSolve::solve() - Allocation-free Steady State
+
+void PreparedSolve::solve() {
+    if (sys.unknowns > 0) {
+        if (!factorValid) {
+            restampMatrix();
+            MemoryScope memory(MEM_FACTORS);
+            chol.factorize(sys.A); // Throws if singular; factorValid stays false
+            factorValid = true;
+        }
+        restampRhs();
+        chol.solve(sys.b, x, work);
+    } else {
+        restampRhs();
+    }
+    for (int i = 0; i < nodes; i++) {
+        int u = sys.nodeToUnknown[i];
+        nodeVoltages[i] = (u >= 0 ? x[u] : 0.0) + sys.nodeOffset[i];
+    }
+}
+
+
+// BatchSolve Constructor - One Factorization Plan for All Instances
+
+// Helper: position of row r in column j of the batch factor pattern
+static int columnEntry(const vector<int>& colPtr, const vector<int>& entryRow, int r, int j) {
+    auto first = entryRow.begin() + colPtr[j], last = entryRow.begin() + colPtr[j + 1];
+    auto it = lower_bound(first, last, r);
+    if (it == last || *it != r) throw logic_error("Batch factor pattern is missing an entry.");
+    return (int)(it - entryRow.begin());
+}
+
+BatchSolve::BatchSolve(const Circuit& circuit, int count) {
+    if (count <= 0) throw invalid_argument("Error: A batch needs at least one instance.");
+    PreparedSolve plan(circuit);
+    instances = count;
+    blocks = (count + LANES - 1) / LANES;
+    nodes = plan.nodes;
+    unknowns = plan.sys.unknowns;
+    offsetWalk = plan.offsetWalk;
+    names = plan.names;
+
+    // Pattern of L from the supernodal structure: column f + c of supernode
+    // s has the rows of s from its own diagonal on
+    const SupernodalStructure& S = plan.chol.structure();
+    colPtr.assign(unknowns + 1, 0);
+    for (int s = 0; s < S.supernodes(); s++) {
+        int f = S.snodeStart[s];
+        for (int c = 0; c < S.cols(s); c++) {
+            for (int t = c; t < S.rows(s); t++) entryRow.push_back(S.rowIdx[S.rowPtr[s] + t]);
+            colPtr[f + c + 1] = (int)entryRow.size();
+        }
+    }
+
+    // Column j is updated by every earlier column k with L(j, k) != 0, on
+    // the rows of k from j down (all of them are in column j too)
+    vector<vector<int>> rowColumns(unknowns);
+    for (int k = 0; k < unknowns; k++) {
+        for (int e = colPtr[k] + 1; e < colPtr[k + 1]; e++) rowColumns[entryRow[e]].push_back(k);
+    }
+    updatePtr.assign(unknowns + 1, 0);
+    for (int j = 0; j < unknowns; j++) {
+        for (int k : rowColumns[j]) {
+            int m = columnEntry(colPtr, entryRow, j, k);
+            for (int e = m; e < colPtr[k + 1]; e++) {
+                updates.push_back({columnEntry(colPtr, entryRow, entryRow[e], j), e, m});
+            }
+        }
+        updatePtr[j + 1] = (int)updates.size();
+    }
+
+    vector<int> pinv = invertPermutation(S.perm);
+    nodeRow.assign(nodes, -1);
+    for (int i = 0; i < nodes; i++) {
+        if (plan.sys.nodeToUnknown[i] >= 0) nodeRow[i] = pinv[plan.sys.nodeToUnknown[i]];
+    }
+    for (const PreparedSolve::Stamp& p : plan.stamps) {
+        Stamp st;
+        st.type = p.type;
+        st.nodeA = p.nodeA;
+        st.nodeB = p.nodeB;
+        st.ra = nodeRow[p.nodeA];
+        st.rb = nodeRow[p.nodeB];
+        if (st.type == RESISTOR && !(st.ra >= 0 && st.ra == st.rb)) {
+            if (st.ra >= 0) st.aa = colPtr[st.ra];
+            if (st.rb >= 0) st.bb = colPtr[st.rb];
+            if (st.ra >= 0 && st.rb >= 0) st.ab = columnEntry(colPtr, entryRow, max(st.ra, st.rb), min(st.ra, st.rb));
+        }
+        stamps.push_back(st);
+    }
+
+    // Padding lanes of the last block keep the circuit's values, so they
+    // factorize like a real instance
+    int components = componentCount();
+    values.resize((size_t)blocks * components * LANES);
+    for (int b = 0; b < blocks; b++) {
+        for (int c = 0; c < components; c++) {
+            for (int l = 0; l < LANES; l++) values[((size_t)b * components + c) * LANES + l] = plan.values[c];
+        }
+    }
+    results.assign((size_t)blocks * nodes * LANES, 0.0);
+    L.assign(entryRow.size() * LANES, 0.0);
+    rhs.assign((size_t)unknowns * LANES, 0.0);
+    offset.assign((size_t)nodes * LANES, 0.0);
+}
+
+
+// BatchSolve Value Access
+
+int BatchSolve::componentIndex(const string& name) const {
+    for (size_t c = 0; c < names.size(); c++) {
+        if (names[c] == name) return (int)c;
+    }
+    return -1;
+}
+
+void BatchSolve::checkIndices(int instance, int component) const {
+    if (instance < 0 || instance >= instances) throw invalid_argument("Error: Instance index out of range.");
+    if (component < 0 || component >= componentCount()) throw invalid_argument("Error: Component index out of range.");
+}
+
+void BatchSolve::setValue(int instance, int component, double value) {
+    checkIndices(instance, component);
+    if (stamps[component].type == RESISTOR && value <= 0) {
+        throw invalid_argument("Error: Resistance must be positive.");
+    }
+    int b = instance / LANES, l = instance % LANES;
+    values[((size_t)b * componentCount() + component) * LANES + l] = value;
+}
+
+double BatchSolve::getValue(int instance, int component) const {
+    checkIndices(instance, component);
+    int b = instance / LANES, l = instance % LANES;
+    return values[((size_t)b * componentCount() + component) * LANES + l];
+}
+
+double BatchSolve::voltage(int instance, int node) const {
+    if (instance < 0 || instance >= instances) throw invalid_argument("Error: Instance index out of range.");
+    if (node < 0 || node >= nodes) throw invalid_argument("Error: Node ID out of range.");
+    int b = instance / LANES, l = instance % LANES;
+    return results[((size_t)b * nodes + node) * LANES + l];
+}
+
+vector<double> BatchSolve::voltages(int instance) const {
+    vector<double> v(nodes);
+    for (int i = 0; i < nodes; i++) v[i] = voltage(instance, i);
+    return v;
+}
+
+
+// BatchSolve::solve() - Interleaved Sparse Cholesky
+
+void BatchSolve::solve() {
+    for (int b = 0; b < blocks; b++) solveBlock(b);
+}
+
+void BatchSolve::solveBlock(int block) {
+    const int W = LANES;
+    const double* val = &values[(size_t)block * componentCount() * W];
+    double* off = offset.data();
+    double* a = L.data();
+    double* y = rhs.data();
+
+    // Offsets along the voltage-source forest (nodes off it stay at 0)
+    fill(offset.begin(), offset.end(), 0.0);
+    for (const PreparedSolve::OffsetStep& step : offsetWalk) {
+        const double* v = val + (size_t)step.source * W;
+        double* to = off + (size_t)step.node * W;
+        const double* from = off + (size_t)step.parent * W;
+        for (int l = 0; l < W; l++) to[l] = from[l] + step.sign * v[l];
+    }
+
+    // Stamp the lower triangle and the right-hand side
+    fill(L.begin(), L.end(), 0.0);
+    fill(rhs.begin(), rhs.end(), 0.0);
+    for (size_t c = 0; c < stamps.size(); c++) {
+        const Stamp& st = stamps[c];
+        const double* v = val + c * W;
+        if (st.type == RESISTOR) {
+            if (st.ra >= 0 && st.ra == st.rb) continue;
+            const double* oa = off + (size_t)st.nodeA * W;
+            const double* ob = off + (size_t)st.nodeB * W;
+            double g[LANES];
+            for (int l = 0; l < W; l++) g[l] = 1.0 / v[l];
+            if (st.ra >= 0) {
+                double* ya = y + (size_t)st.ra * W;
+                double* aa = a + (size_t)st.aa * W;
+                for (int l = 0; l < W; l++) { aa[l] += g[l]; ya[l] -= g[l] * (oa[l] - ob[l]); }
+            }
+            if (st.rb >= 0) {
+                double* yb = y + (size_t)st.rb * W;
+                double* bb = a + (size_t)st.bb * W;
+                for (int l = 0; l < W; l++) { bb[l] += g[l]; yb[l] -= g[l] * (ob[l] - oa[l]); }
+            }
+            if (st.ab >= 0) {
+                double* ab = a + (size_t)st.ab * W;
+                for (int l = 0; l < W; l++) ab[l] -= g[l];
+            }
+        } else if (st.type == CURRENT_SOURCE) {
+            if (st.ra >= 0) for (int l = 0; l < W; l++) y[(size_t)st.ra * W + l] -= v[l];
+            if (st.rb >= 0) for (int l = 0; l < W; l++) y[(size_t)st.rb * W + l] += v[l];
+        }
+    }
+
+    // Left-looking Cholesky, column by column. A pivot that loses twelve
+    // digits against the original diagonal marks its lane singular; lanes
+    // never branch, the check happens once per block.
+    bool ok[LANES];
+    for (int l = 0; l < W; l++) ok[l] = true;
+    for (int j = 0; j < unknowns; j++) {
+        double* d = a + (size_t)colPtr[j] * W;
+        double tolerance[LANES];
+        for (int l = 0; l < W; l++) tolerance[l] = 1e-12 * d[l];
+        for (int u = updatePtr[j]; u < updatePtr[j + 1]; u++) {
+            double* t = a + (size_t)updates[u].target * W;
+            const double* s = a + (size_t)updates[u].source * W;
+            const double* m = a + (size_t)updates[u].multiplier * W;
+            for (int l = 0; l < W; l++) t[l] -= s[l] * m[l];
+        }
+        double inv[LANES];
+        for (int l = 0; l < W; l++) {
+            ok[l] = ok[l] && d[l] > tolerance[l];
+            d[l] = sqrt(d[l]);
+            inv[l] = 1.0 / d[l];
+        }
+        for (int e = colPtr[j] + 1; e < colPtr[j + 1]; e++) {
+            double* x = a + (size_t)e * W;
+            for (int l = 0; l < W; l++) x[l] *= inv[l];
+        }
+    }
+    for (int l = 0; l < W && block * W + l < instances; l++) {
+        if (!ok[l]) throw runtime_error(string(SINGULAR_MESSAGE) + " (instance " + to_string(block * W + l) + ")");
+    }
+
+    // L z = b, then L^T x = z, in place
+    for (int j = 0; j < unknowns; j++) {
+        double* yj = y + (size_t)j * W;
+        const double* d = a + (size_t)colPtr[j] * W;
+        for (int l = 0; l < W; l++) yj[l] /= d[l];
+        for (int e = colPtr[j] + 1; e < colPtr[j + 1]; e++) {
+            const double* x = a + (size_t)e * W;
+            double* yr = y + (size_t)entryRow[e] * W;
+            for (int l = 0; l < W; l++) yr[l] -= x[l] * yj[l];
+        }
+    }
+    for (int j = unknowns - 1; j >= 0; j--) {
+        double* yj = y + (size_t)j * W;
+        for (int e = colPtr[j] + 1; e < colPtr[j + 1]; e++) {
+            const double* x = a + (size_t)e * W;
+            const double* yr = y + (size_t)entryRow[e] * W;
+            for (int l = 0; l < W; l++) yj[l] -= x[l] * yr[l];
+        }
+        const double* d = a + (size_t)colPtr[j] * W;
+        for (int l = 0; l < W; l++) yj[l] /= d[l];
+    }
+
+    double* out = &results[(size_t)block * nodes * W];
+    for (int i = 0; i < nodes; i++) {
+        int r = nodeRow[i];
+        for (int l = 0; l < W; l++) out[(size_t)i * W + l] = (r >= 0 ? y[(size_t)r * W + l] : 0.0) + off[(size_t)i * W + l];
+    }
+}
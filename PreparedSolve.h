@@ -0,0 +1,166 @@
+#ifndef PREPARED_SOLVE_H
+#define PREPARED_SOLVE_H
+
+#include <vector>
+#include <string>
+#include "CircuitSolver.h"
+#include "SparseSolver.h"
+
+using namespace std;
+
+
+// 1. Prepared Re-solve (fixed topology, changing values)
+
+
+// Solves the same circuit over and over with new component values. The
+// constructor does everything that depends only on the topology: the
+// voltage-source reduction, the sparsity pattern, the fill-reducing ordering
+// and the supernodal analysis, plus a stamp plan that says which matrix and
+// right-hand side entries each component writes. It also sizes every
+// workspace, so after the first solve() no later solve() touches the heap.
+//
+// Changing a resistor refactorizes (same pattern, new values); changing only
+// sources reuses the factor and just redoes the substitutions.
+class PreparedSolve {
+private:
+    // Where one component writes. Unknown indices are -1 for fixed nodes;
+    // value positions index A.values and are -1 when the entry is absent.
+    struct Stamp {
+        ComponentType type;
+        int nodeA, nodeB;
+        int ua, ub;
+        int aa = -1, ab = -1, ba = -1, bb = -1;
+    };
+
+    // One step of the voltage-source forest walk: V(node) = V(parent) + sign * value(source)
+    struct OffsetStep {
+        int node, parent, source;
+        double sign;
+    };
+
+    int nodes = 0;              // Node IDs run 0..nodes-1
+    vector<double> values;      // Per component, in Circuit::getComponents() order
+    vector<string> names;
+    vector<Stamp> stamps;
+    vector<OffsetStep> offsetWalk;
+
+    NodalSystem sys;            // Pattern fixed at preparation; values and b restamped
+    SparseCholesky chol;
+    bool factorValid = false;   // False after a resistor changed
+
+    // Workspaces, sized once
+    vector<double> x, work, nodeVoltages;
+
+    void restampMatrix();
+    void restampRhs();
+
+    friend class BatchSolve; // Builds on the stamp plan and the offset walk
+
+public:
+    // Throws runtime_error for the circuits Circuit::solve() rejects: empty,
+    // no ground, voltage-source loops, floating nodes
+    explicit PreparedSolve(const Circuit& circuit);
+
+    int componentCount() const { return (int)values.size(); }
+    int componentIndex(const string& name) const; // -1 if there is no such component
+    double getValue(int index) const { return values.at(index); }
+
+    // Resistance (Ohms), current (Amps) or voltage (Volts) of a component.
+    // Throws invalid_argument for a bad index or a non-positive resistance.
+    void setValue(int index, double value);
+
+    // Throws runtime_error if the new values make the matrix singular
+    void solve();
+
+    // Results of the last solve(), indexed by node ID (index 0 = ground)
+    const vector<double>& voltages() const { return nodeVoltages; }
+
+    // Install (and publish) the results in the circuit this was prepared
+    // from. Allocation free from the third install on: the first creates the
+    // voltage entries, the second fills the other result snapshot buffer.
+    void applyTo(Circuit& circuit) const { circuit.applyVoltages(nodeVoltages); }
+};
+
+
+// 2. Batched Solve (same topology, many value sets)
+
+
+// Solves many instances of one circuit that differ only in their component
+// values, such as the rows of a characterization table. Instances are
+// grouped in blocks of LANES and every array is interleaved across a block
+// (structure of arrays), so each step of the factorization works on LANES
+// circuits at once, in innermost loops with a fixed trip count that the
+// compiler turns into SIMD instructions (CIRCUIT_NATIVE gives the widest).
+//
+// The factorization follows the pattern of PreparedSolve's sparse factor:
+// it is flattened into a list of multiply-subtract updates between entries
+// of L, so an instance costs the sparse flop count with no index work or
+// branches left in the loops.
+class BatchSolve {
+public:
+    static const int LANES = 8;
+
+private:
+    // Where one component writes; rows are in factor order, entries index
+    // the nonzeros of L (-1 for fixed nodes or absent entries)
+    struct Stamp {
+        ComponentType type;
+        int nodeA, nodeB;
+        int ra = -1, rb = -1;
+        int aa = -1, ab = -1, bb = -1;
+    };
+
+    // L[target] -= L[source] * L[multiplier]
+    struct Update {
+        int target, source, multiplier;
+    };
+
+    int instances = 0, blocks = 0;
+    int nodes = 0, unknowns = 0;
+    vector<Stamp> stamps;
+    vector<PreparedSolve::OffsetStep> offsetWalk;
+    vector<int> nodeRow; // Per node ID: factor row of its unknown, -1 if fixed
+    vector<string> names;
+
+    // Nonzeros of L by column, diagonal first, rows ascending
+    vector<int> colPtr, entryRow;
+    vector<Update> updates;
+    vector<int> updatePtr; // Updates of column j: updatePtr[j] .. updatePtr[j+1]
+
+    // Interleaved per block: values[(block * components + c) * LANES + lane],
+    // results[(block * nodes + node) * LANES + lane]
+    vector<double> values, results;
+
+    // One block's workspace: L, the right-hand side (solution in place)
+    // and the node offsets
+    vector<double> L, rhs, offset;
+
+    void checkIndices(int instance, int component) const;
+    void solveBlock(int block);
+
+    friend string generateSolverSource(const Circuit& circuit, const string& functionName);
+    friend class GeneratedSolver; // Emits the same plan as straight-line code
+
+public:
+    // Every instance starts with the circuit's values. Throws like
+    // PreparedSolve's constructor, or invalid_argument if instances < 1.
+    BatchSolve(const Circuit& circuit, int instances);
+
+    int instanceCount() const { return instances; }
+    int componentCount() const { return (int)stamps.size(); }
+    int componentIndex(const string& name) const; // -1 if there is no such component
+
+    // Throws invalid_argument for bad indices or a non-positive resistance
+    void setValue(int instance, int component, double value);
+    double getValue(int instance, int component) const;
+
+    // Throws runtime_error naming the first instance whose matrix is singular
+    void solve();
+
+    // Results of the last solve(), by node ID (0 = ground)
+    double voltage(int instance, int node) const;
+    vector<double> voltages(int instance) const;
+    void applyTo(int instance, Circuit& circuit) const { circuit.applyVoltages(voltages(instance)); }
+};
+
+#endif // PREPARED_SOLVE_H
@@ -0,0 +1,240 @@
+#include "ResultCache.h"
+#include "SparseSolver.h"
+#include "TraceRecorder.h"
+#include <algorithm>
+#include <numeric>
+#include <fstream>
+#include <filesystem>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <stdexcept>
+
+using namespace std;
+
+// Colour refinement visits every component end once per round; the rounds
+// are capped so that about this many visits are spent on a large circuit
+const long long CANONICAL_WORK_LIMIT = 10000000;
+const int MIN_REFINEMENT_ROUNDS = 8;
+
+// Tied nodes told apart one at a time before the rest are broken by node ID
+const int MAX_INDIVIDUALIZATIONS = 64;
+
+
+// Helper: 64-bit mixing (splitmix64 finalizer)
+
+static unsigned long long mix64(unsigned long long x) {
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+static unsigned long long valueBits(double value) {
+    unsigned long long bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+// Helper: number of distinct colours
+static int countClasses(const vector<unsigned long long>& color, vector<unsigned long long>& scratch) {
+    scratch = color;
+    sort(scratch.begin(), scratch.end());
+    return (int)(unique(scratch.begin(), scratch.end()) - scratch.begin());
+}
+
+
+// canonicalizeCircuit() - Colour Refinement with Individualization
+
+CanonicalCircuit canonicalizeCircuit(const Circuit& circuit) {
+    TraceScope scope("canonicalize", "cache");
+    const ComponentList& comps = circuit.getComponents();
+    int n = circuit.getNodeCount() + 1; // Ground included
+
+    // Component ends per node. The label carries the component type, its
+    // exact value and which end this is (resistors look the same from both)
+    struct End {
+        int neighbor;
+        unsigned long long label;
+    };
+    vector<int> start(n + 1, 0);
+    for (const auto& comp : comps) {
+        start[comp->nodeA_ID + 1]++;
+        start[comp->nodeB_ID + 1]++;
+    }
+    for (int v = 0; v < n; v++) start[v + 1] += start[v];
+    vector<End> ends(start[n]);
+    vector<int> next(start.begin(), start.end() - 1);
+    for (const auto& comp : comps) {
+        ComponentType type = comp->getType();
+        unsigned long long base = mix64(valueBits(comp->value)) ^ mix64(0x100 + type);
+        unsigned long long atA = type == RESISTOR ? base : mix64(base ^ 1);
+        unsigned long long atB = type == RESISTOR ? base : mix64(base ^ 2);
+        ends[next[comp->nodeA_ID]++] = {comp->nodeB_ID, atA};
+        ends[next[comp->nodeB_ID]++] = {comp->nodeA_ID, atB};
+    }
+
+    vector<unsigned long long> color(n, mix64(2)), refined(n), scratch;
+    color[0] = mix64(1);
+    int classes = countClasses(color, scratch);
+    long long roundBudget = max<long long>(MIN_REFINEMENT_ROUNDS, CANONICAL_WORK_LIMIT / max<long long>(1, n + (long long)ends.size()));
+
+    // Rounds until the partition stops splitting (true), or out of budget.
+    // A node's new colour includes its old one, so classes only ever split.
+    auto refine = [&]() {
+        while (roundBudget > 0) {
+            roundBudget--;
+            for (int v = 0; v < n; v++) {
+                unsigned long long sum = 0; // Commutative: neighbour order is irrelevant
+                for (int e = start[v]; e < start[v + 1]; e++) sum += mix64(ends[e].label ^ mix64(color[ends[e].neighbor]));
+                refined[v] = mix64(color[v] ^ mix64(sum));
+            }
+            color.swap(refined);
+            int split = countClasses(color, scratch);
+            if (split == classes) return true;
+            classes = split;
+        }
+        return false;
+    };
+
+    // Ordering by colour, node ID for ties
+    vector<int> order(n);
+    auto sortNodes = [&]() {
+        iota(order.begin(), order.end(), 0);
+        sort(order.begin(), order.end(), [&](int a, int b) { return color[a] != color[b] ? color[a] < color[b] : a < b; });
+    };
+
+    CanonicalCircuit canonical;
+    canonical.exact = refine();
+    for (int step = 0; canonical.exact && classes < n; step++) {
+        if (step == MAX_INDIVIDUALIZATIONS) {
+            canonical.exact = false;
+            break;
+        }
+        // The smallest colour shared by several nodes: single one of them out
+        sortNodes();
+        int k = 0;
+        while (color[order[k]] != color[order[k + 1]]) k++;
+        color[order[k]] = mix64(color[order[k]] ^ 0x5EED);
+        classes++;
+        canonical.exact = refine();
+    }
+
+    sortNodes();
+    canonical.canonicalIndex.assign(n, 0);
+    int index = 1;
+    for (int v : order) {
+        if (v != 0) canonical.canonicalIndex[v] = index++;
+    }
+
+    canonical.components.reserve(comps.size());
+    for (const auto& comp : comps) {
+        CanonicalComponent c;
+        c.type = comp->getType();
+        c.nodeA = canonical.canonicalIndex[comp->nodeA_ID];
+        c.nodeB = canonical.canonicalIndex[comp->nodeB_ID];
+        if (c.type == RESISTOR && c.nodeA > c.nodeB) swap(c.nodeA, c.nodeB);
+        c.value = comp->value;
+        canonical.components.push_back(c);
+    }
+    auto key = [](const CanonicalComponent& c) { return make_tuple(c.type, c.nodeA, c.nodeB, valueBits(c.value)); };
+    sort(canonical.components.begin(), canonical.components.end(),
+         [&](const CanonicalComponent& a, const CanonicalComponent& b) { return key(a) < key(b); });
+
+    unsigned long long h = mix64((unsigned long long)n);
+    for (const CanonicalComponent& c : canonical.components) {
+        h = mix64(h ^ (unsigned long long)c.type);
+        h = mix64(h ^ (unsigned long long)c.nodeA);
+        h = mix64(h ^ (unsigned long long)c.nodeB);
+        h = mix64(h ^ valueBits(c.value));
+    }
+    canonical.hash = h;
+    return canonical;
+}
+
+
+// Result Files
+// Layout: the header, the canonical components, then the voltages by
+// canonical index (ground first).
+
+static const char RESULT_FILE_MAGIC[8] = {'C', 'I', 'R', 'C', 'R', 'S', 'L', 'T'};
+static const uint32_t RESULT_FILE_VERSION = 1;
+static const uint32_t RESULT_FILE_BYTE_ORDER = 0x01020304;
+
+struct ResultFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint64_t hash;
+    int64_t nodes;      // Ground included
+    int64_t components;
+};
+
+struct ResultFileComponent {
+    int32_t type, nodeA, nodeB, unused;
+    double value;
+};
+
+// Helper: cache file of a canonical form
+static string resultPath(const string& directory, unsigned long long hash) {
+    char name[40];
+    snprintf(name, sizeof(name), "result_%016llx.bin", hash);
+    return (filesystem::path(directory) / name).string();
+}
+
+bool lookupCachedResult(const string& directory, const CanonicalCircuit& canonical, vector<double>& voltages) {
+    TraceScope io("result_lookup", "cache");
+    ifstream in(resultPath(directory, canonical.hash), ios::binary);
+    if (!in) return false;
+
+    ResultFileHeader h;
+    if (!in.read(reinterpret_cast<char*>(&h), sizeof(h))) return false;
+    int64_t nodes = (int64_t)canonical.canonicalIndex.size();
+    if (memcmp(h.magic, RESULT_FILE_MAGIC, sizeof(h.magic)) != 0 || h.version != RESULT_FILE_VERSION ||
+        h.byteOrder != RESULT_FILE_BYTE_ORDER || h.hash != canonical.hash || h.nodes != nodes ||
+        h.components != (int64_t)canonical.components.size()) {
+        return false;
+    }
+
+    // The hash only names the file: the stored form must be the caller's
+    vector<ResultFileComponent> stored(h.components);
+    if (!in.read(reinterpret_cast<char*>(stored.data()), stored.size() * sizeof(ResultFileComponent))) return false;
+    for (size_t i = 0; i < stored.size(); i++) {
+        const CanonicalComponent& c = canonical.components[i];
+        const ResultFileComponent& s = stored[i];
+        if (s.type != c.type || s.nodeA != c.nodeA || s.nodeB != c.nodeB || valueBits(s.value) != valueBits(c.value)) {
+            return false;
+        }
+    }
+    vector<double> byCanonical(nodes);
+    if (!in.read(reinterpret_cast<char*>(byCanonical.data()), nodes * sizeof(double))) return false;
+
+    voltages.assign(nodes, 0.0);
+    for (int64_t id = 0; id < nodes; id++) voltages[id] = byCanonical[canonical.canonicalIndex[id]];
+    return true;
+}
+
+void storeCachedResult(const string& directory, const CanonicalCircuit& canonical, const vector<double>& voltages) {
+    TraceScope io("result_store", "cache");
+    ResultFileHeader h = {};
+    memcpy(h.magic, RESULT_FILE_MAGIC, sizeof(h.magic));
+    h.version = RESULT_FILE_VERSION;
+    h.byteOrder = RESULT_FILE_BYTE_ORDER;
+    h.hash = canonical.hash;
+    h.nodes = (int64_t)canonical.canonicalIndex.size();
+    h.components = (int64_t)canonical.components.size();
+
+    vector<ResultFileComponent> stored(canonical.components.size());
+    for (size_t i = 0; i < stored.size(); i++) {
+        const CanonicalComponent& c = canonical.components[i];
+        stored[i] = {c.type, c.nodeA, c.nodeB, 0, c.value};
+    }
+    vector<double> byCanonical(h.nodes, 0.0);
+    for (int64_t id = 0; id < h.nodes; id++) byCanonical[canonical.canonicalIndex[id]] = voltages[id];
+
+    replaceFile(resultPath(directory, canonical.hash), "result file", [&](ostream& out) {
+        out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+        out.write(reinterpret_cast<const char*>(stored.data()), stored.size() * sizeof(ResultFileComponent));
+        out.write(reinterpret_cast<const char*>(byCanonical.data()), byCanonical.size() * sizeof(double));
+    });
+}
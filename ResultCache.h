@@ -0,0 +1,61 @@
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include <vector>
+#include <string>
+#include "CircuitSolver.h"
+
+using namespace std;
+
+
+// 1. Canonical Form (order- and name-independent)
+
+
+// A component with canonical node indices (0 = ground). Resistors are
+// stored with nodeA < nodeB; sources keep their orientation.
+struct CanonicalComponent {
+    int type = RESISTOR;
+    int nodeA = 0;
+    int nodeB = 0;
+    double value = 0;
+};
+
+struct CanonicalCircuit {
+    vector<int> canonicalIndex;            // Per node ID: canonical index (ground stays 0)
+    vector<CanonicalComponent> components; // Sorted, so equal lists mean the same circuit
+    unsigned long long hash = 0;           // Of the sorted list
+    bool exact = true;                     // False if some ties were broken by node ID (see below)
+};
+
+// Canonical numbering of the circuit's nodes by colour refinement
+// (Weisfeiler-Lehman): every node starts with one colour (ground its own),
+// and each round hashes a node's colour with the multiset of its
+// neighbours' colours and the types, exact values and orientations of the
+// components joining them. Nodes still tied when that is stable are told
+// apart one at a time (individualize, refine again), which is canonical
+// whenever tied nodes are interchangeable by a symmetry of the circuit.
+// Component order and node and component names never matter. Highly
+// regular circuits (many identical values) may exhaust the round budget;
+// their remaining ties are broken by node ID and `exact` is false. Such a
+// form may differ between two orderings of the same circuit. That costs
+// a cache miss, never a wrong hit: equal forms always mean isomorphic
+// circuits.
+CanonicalCircuit canonicalizeCircuit(const Circuit& circuit);
+
+
+// 2. On-disk Result Cache
+
+
+// Results of solved circuits in `directory`, one versioned file per
+// canonical form (result_<hash>.bin) holding the form itself and the
+// voltages by canonical index. A lookup compares the stored form with the
+// caller's, so a hash collision is a miss.
+
+// Voltages by the caller's node IDs (index 0 = ground); false on a miss
+bool lookupCachedResult(const string& directory, const CanonicalCircuit& canonical, vector<double>& voltages);
+
+// voltages by node ID. Written aside and renamed into place; throws
+// runtime_error if the file cannot be written.
+void storeCachedResult(const string& directory, const CanonicalCircuit& canonical, const vector<double>& voltages);
+
+#endif // RESULT_CACHE_H
@@ -0,0 +1,246 @@
+#include "SolveScheduler.h"
+#include "TraceRecorder.h"
+#include <stdexcept>
+#include <exception>
+
+using namespace std;
+
+// The scheduler and worker index of the calling thread (none off the pool)
+static thread_local SolveScheduler* currentScheduler = nullptr;
+static thread_local int currentWorker = -1;
+
+
+// SolveScheduler Lifetime
+
+SolveScheduler::SolveScheduler(int workerThreads, size_t limit) : memoryLimit(limit), backgroundMemoryLimit(limit) {
+    if (workerThreads <= 0) workerThreads = max(1, (int)thread::hardware_concurrency());
+    if (workerThreads > 1) backgroundMemoryLimit = limit - limit / workerThreads;
+    // Every worker exists before any thread starts stealing from it
+    for (int i = 0; i < workerThreads; i++) workers.push_back(make_unique<Worker>());
+    for (int i = 0; i < workerThreads; i++) workers[i]->runner = thread(&SolveScheduler::workerLoop, this, i);
+}
+
+SolveScheduler::~SolveScheduler() {
+    {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& w : workers) w->runner.join();
+}
+
+future<Status> SolveScheduler::submit(Circuit& circuit, const JobOptions& options) {
+    if (options.priority < 0 || options.priority >= PRIORITY_LEVELS) {
+        throw invalid_argument("Error: Unknown job priority.");
+    }
+    size_t quota = options.memoryQuota;
+    if (memoryLimit > 0 && quota > memoryLimit) {
+        throw invalid_argument("Error: Memory quota exceeds the scheduler's memory limit.");
+    }
+    if (memoryLimit > 0 && options.priority != PRIORITY_INTERACTIVE && quota > backgroundMemoryLimit) {
+        throw invalid_argument("Error: Memory quota exceeds what jobs that are not interactive may reserve.");
+    }
+    auto job = make_shared<Job>();
+    job->circuit = &circuit;
+    job->priority = options.priority;
+    job->quota = quota;
+    future<Status> result = job->done.get_future();
+    {
+        lock_guard<mutex> guard(lock);
+        jobs[options.priority].push_back(move(job));
+    }
+    wake.notify_all();
+    return result;
+}
+
+SchedulerCounters SolveScheduler::counters() {
+    lock_guard<mutex> guard(lock);
+    SchedulerCounters c = totals;
+    c.tasks = tasksRun.load();
+    c.stolen = tasksStolen.load();
+    return c;
+}
+
+
+// Worker Loop - Highest Priority First, Tasks Before New Jobs
+
+void SolveScheduler::workerLoop(int index) {
+    currentScheduler = this;
+    currentWorker = index;
+    setTraceThreadName("scheduler worker " + to_string(index));
+
+    while (true) {
+        bool ran = false;
+        for (int p = 0; p < PRIORITY_LEVELS && !ran; p++) {
+            Task task;
+            if (takeTask(index, p, task)) {
+                runTask(index, task);
+                ran = true;
+                break;
+            }
+            shared_ptr<Job> job;
+            {
+                lock_guard<mutex> guard(lock);
+                job = takeJob(p);
+            }
+            if (job) {
+                runJob(*job);
+                ran = true;
+            }
+        }
+        if (ran) continue;
+
+        unique_lock<mutex> guard(lock);
+        auto ready = [&]() {
+            if (queuedTasks.load() > 0) return true;
+            for (int p = 0; p < PRIORITY_LEVELS; p++) {
+                if (!jobs[p].empty() && canStart(*jobs[p].front())) return true;
+            }
+            return false;
+        };
+        auto drained = [&]() {
+            for (int p = 0; p < PRIORITY_LEVELS; p++) if (!jobs[p].empty()) return false;
+            return true;
+        };
+        wake.wait(guard, [&]() { return ready() || (stopping && drained()); });
+        if (stopping && drained() && queuedTasks.load() == 0) break;
+    }
+}
+
+// Own newest task first, then the oldest task of another worker
+bool SolveScheduler::takeTask(int index, int priority, Task& task) {
+    if (queuedTasks.load() == 0) return false;
+    int n = (int)workers.size();
+    for (int k = 0; k < n; k++) {
+        Worker& w = *workers[(index + k) % n];
+        lock_guard<mutex> guard(w.lock);
+        deque<Task>& tasks = w.tasks[priority];
+        if (tasks.empty()) continue;
+        if (k == 0) {
+            task = move(tasks.back());
+            tasks.pop_back();
+        } else {
+            task = move(tasks.front());
+            tasks.pop_front();
+        }
+        queuedTasks--;
+        return true;
+    }
+    return false;
+}
+
+void SolveScheduler::runTask(int index, Task& task) {
+    tasksRun++;
+    if (task.spawner != index) tasksStolen++;
+    task.run();
+}
+
+bool SolveScheduler::canStart(const Job& job) const {
+    if (job.priority == PRIORITY_INTERACTIVE) return memoryLimit == 0 || memoryInUse + job.quota <= memoryLimit;
+    // Others keep a worker and the interactive memory reserve free
+    int workerThreads = (int)workers.size();
+    if (workerThreads > 1 && backgroundJobs >= workerThreads - 1) return false;
+    return memoryLimit == 0 || memoryInUse + job.quota <= backgroundMemoryLimit;
+}
+
+// Jobs of one priority start in submission order, so a large quota is not
+// starved by smaller ones behind it
+shared_ptr<SolveScheduler::Job> SolveScheduler::takeJob(int priority) {
+    deque<shared_ptr<Job>>& queue = jobs[priority];
+    if (queue.empty() || !canStart(*queue.front())) return nullptr;
+    shared_ptr<Job> job = move(queue.front());
+    queue.pop_front();
+    memoryInUse += job->quota;
+    if (job->priority != PRIORITY_INTERACTIVE) backgroundJobs++;
+    return job;
+}
+
+void SolveScheduler::notifyWorkers() {
+    // Taking the lock orders this with a worker between its check and its wait
+    { lock_guard<mutex> guard(lock); }
+    wake.notify_all();
+}
+
+
+// SolveScheduler::runJob() - One Circuit Solve
+
+void SolveScheduler::runJob(Job& job) {
+    Circuit& circuit = *job.circuit;
+    size_t budget = circuit.getMaxMemory();
+    if (job.quota > 0 && (budget == 0 || job.quota < budget)) circuit.setMaxMemory(job.quota);
+    JobPriority priority = job.priority;
+    circuit.setParallelism([this, priority](int count, const function<void(int)>& body) {
+        parallelFor(count, body, priority);
+    }, workerCount());
+
+    Status status;
+    {
+        TraceScope scope("scheduled_solve", "scheduler", priority);
+        status = circuit.solve();
+    }
+    circuit.setParallelism(nullptr, 1);
+    circuit.setMaxMemory(budget);
+
+    {
+        lock_guard<mutex> guard(lock);
+        memoryInUse -= job.quota;
+        if (job.priority != PRIORITY_INTERACTIVE) backgroundJobs--;
+        totals.jobs++;
+    }
+    wake.notify_all(); // Its quota and worker slot may let a queued job start
+    job.done.set_value(status);
+}
+
+
+// SolveScheduler::parallelFor() - Internal Tasks of a Running Job
+
+void SolveScheduler::parallelFor(int count, const function<void(int)>& body, JobPriority priority) {
+    if (currentScheduler != this || count <= 1) {
+        for (int i = 0; i < count; i++) body(i);
+        return;
+    }
+
+    struct Group {
+        int remaining;
+        mutex lock; // Guards everything above and below
+        condition_variable finished;
+        exception_ptr error;
+    } group;
+    group.remaining = count;
+    auto runOne = [&group, &body](int i) {
+        exception_ptr error;
+        try {
+            body(i);
+        } catch (...) {
+            error = current_exception();
+        }
+        // Last touch, under the lock: the caller cannot return before it ends
+        lock_guard<mutex> guard(group.lock);
+        if (error && !group.error) group.error = error;
+        if (--group.remaining == 0) group.finished.notify_all();
+    };
+
+    int self = currentWorker;
+    {
+        Worker& w = *workers[self];
+        lock_guard<mutex> guard(w.lock);
+        for (int i = count - 1; i >= 1; i--) w.tasks[priority].push_back({[runOne, i]() { runOne(i); }, self});
+    }
+    queuedTasks += count - 1;
+    notifyWorkers();
+
+    // Run the first task, then help with internal tasks while any are
+    // queued; once none is, sleep until the ones other workers took finish
+    runOne(0);
+    unique_lock<mutex> guard(group.lock);
+    while (group.remaining > 0) {
+        guard.unlock();
+        Task task;
+        bool found = false;
+        for (int p = 0; p < PRIORITY_LEVELS && !found; p++) found = takeTask(self, p, task);
+        if (found) runTask(self, task);
+        guard.lock();
+        if (!found) group.finished.wait(guard, [&group] { return group.remaining == 0; });
+    }
+    if (group.error) rethrow_exception(group.error);
+}
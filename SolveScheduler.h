@@ -0,0 +1,126 @@
+#ifndef SOLVE_SCHEDULER_H
+#define SOLVE_SCHEDULER_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <atomic>
+#include <functional>
+#include "CircuitSolver.h"
+
+using namespace std;
+
+
+// 1. Job Options
+
+
+// Lower values are served first. Priorities order whole jobs as well as the
+// internal tasks of running ones, so an idle worker starts an interactive
+// job before it helps with a batch factorization.
+enum JobPriority {
+    PRIORITY_INTERACTIVE,
+    PRIORITY_NORMAL,
+    PRIORITY_BATCH
+};
+const int PRIORITY_LEVELS = 3;
+
+struct JobOptions {
+    JobPriority priority = PRIORITY_NORMAL;
+    // Bytes. Reserved against the scheduler's memory limit while the job
+    // runs, and the circuit's memory budget for this solve (so the planner
+    // picks a backend that fits, see Circuit::setMaxMemory()). 0 = no
+    // reservation: the job starts whenever a worker is free and solves
+    // under the circuit's own budget.
+    size_t memoryQuota = 0;
+};
+
+struct SchedulerCounters {
+    long long jobs = 0;   // Finished jobs
+    long long tasks = 0;  // Internal (factorization) tasks run
+    long long stolen = 0; // Of those, run by a worker other than the one that spawned it
+};
+
+
+// 2. Work-stealing Scheduler
+
+
+// A fixed pool of workers shared by many circuit solves. Each worker keeps
+// its own deques of internal tasks, one per priority: it pops its newest
+// task, while an idle worker steals the oldest task of a busy one, so a
+// large sparse factorization spreads its independent subtrees over
+// whichever workers have nothing more urgent to do. New jobs wait in one
+// queue per priority and start in order once their memory quota fits.
+//
+// Scheduling is not preemptive. To keep interactive jobs from queueing
+// behind multi-minute factorizations, the other jobs may occupy at most all
+// workers but one at a time, and reserve at most the memory limit less one
+// worker's share of it; only interactive jobs may use that reserve.
+class SolveScheduler {
+private:
+    struct Task {
+        function<void()> run;
+        int spawner; // Worker whose deque it was pushed to
+    };
+
+    struct Job {
+        Circuit* circuit;
+        JobPriority priority;
+        size_t quota;
+        promise<Status> done;
+    };
+
+    struct Worker {
+        mutex lock;
+        deque<Task> tasks[PRIORITY_LEVELS];
+        thread runner;
+    };
+
+    vector<unique_ptr<Worker>> workers;
+    size_t memoryLimit;
+    size_t backgroundMemoryLimit; // What jobs that are not interactive may reserve
+
+    mutex lock; // Guards the job queues and everything below it
+    condition_variable wake;
+    deque<shared_ptr<Job>> jobs[PRIORITY_LEVELS];
+    size_t memoryInUse = 0;
+    int backgroundJobs = 0; // Running jobs that are not interactive
+    bool stopping = false;
+    SchedulerCounters totals;
+
+    atomic<int> queuedTasks{0}; // Internal tasks in the worker deques
+    atomic<long long> tasksRun{0}, tasksStolen{0};
+
+    void workerLoop(int index);
+    bool takeTask(int index, int priority, Task& task);
+    bool canStart(const Job& job) const; // Caller holds `lock`
+    shared_ptr<Job> takeJob(int priority); // Caller holds `lock`
+    void runTask(int index, Task& task);
+    void runJob(Job& job);
+    void notifyWorkers();
+
+    // Fork-join for a job's internal tasks, called on the worker running it.
+    // The caller runs tasks itself while it waits, so nothing can deadlock.
+    void parallelFor(int count, const function<void(int)>& body, JobPriority priority);
+
+public:
+    // workers <= 0: one per hardware thread. memoryLimit 0 = no limit.
+    explicit SolveScheduler(int workers = 0, size_t memoryLimit = 0);
+    ~SolveScheduler(); // Finishes every queued job first
+    SolveScheduler(const SolveScheduler&) = delete;
+    SolveScheduler& operator=(const SolveScheduler&) = delete;
+
+    // Solves the circuit on a worker. The circuit must stay alive and must
+    // not be used until the future is ready. Throws invalid_argument if the
+    // quota exceeds what the job may ever reserve (the job could never
+    // start): the memory limit, less the interactive reserve for jobs that
+    // are not interactive.
+    future<Status> submit(Circuit& circuit, const JobOptions& options = JobOptions());
+
+    int workerCount() const { return (int)workers.size(); }
+    SchedulerCounters counters();
+};
+
+#endif // SOLVE_SCHEDULER_H
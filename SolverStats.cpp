@@ -0,0 +1,145 @@
+#include "SolverStats.h"
+#include <iomanip>
+
+
+// Helper: Phase Names (also the JSON keys)
+
+const char* phaseName(StatPhase phase) {
+    switch (phase) {
+        case PHASE_LOAD: return "load";
+        case PHASE_INTERNING: return "interning";
+        case PHASE_ASSEMBLY: return "assembly";
+        case PHASE_ORDERING: return "ordering";
+        case PHASE_FACTORIZATION: return "factorization";
+        case PHASE_TRIANGULAR_SOLVE: return "triangular_solve";
+        case PHASE_ITERATIVE_SOLVE: return "iterative_solve";
+        case PHASE_OUTPUT: return "output";
+        case PHASE_COUNT: break;
+    }
+    return "unknown";
+}
+
+
+// Helpers: JSON output
+
+static string jsonEscape(const string& text) {
+    string escaped;
+    for (char c : text) {
+        if (c == '"' || c == '\\') escaped += '\\';
+        escaped += c;
+    }
+    return escaped;
+}
+
+// Raw counts plus the derived rates: instructions per cycle, LLC misses per
+// LLC reference and mispredicted branches per branch
+static void writeCounters(ostream& out, const PhaseTiming& t) {
+    bool any = false;
+    for (bool valid : t.eventValid) any = any || valid;
+    if (!any) return;
+
+    out << ", \"counters\": {";
+    bool first = true;
+    for (int e = 0; e < HW_EVENT_COUNT; e++) {
+        if (!t.eventValid[e]) continue;
+        out << (first ? "" : ", ") << "\"" << hardwareEventName((HardwareEvent)e) << "\": " << (long long)t.events[e];
+        first = false;
+    }
+    auto ratio = [&](HardwareEvent num, HardwareEvent den, const char* key) {
+        if (t.eventValid[num] && t.eventValid[den] && t.events[den] > 0) {
+            out << ", \"" << key << "\": " << t.events[num] / t.events[den];
+        }
+    };
+    ratio(HW_INSTRUCTIONS, HW_CYCLES, "ipc");
+    ratio(HW_CACHE_MISSES, HW_CACHE_REFERENCES, "llc_miss_rate");
+    ratio(HW_BRANCH_MISSES, HW_BRANCHES, "branch_miss_rate");
+    out << "}";
+}
+
+// Tracked heap per subsystem, RSS and the capacity-planning ratios: what
+// the stored circuit costs per component and per node, and the peak heap
+// of the whole run per node
+static void writeMemory(ostream& out, const SolverStats& stats) {
+    MemorySnapshot snap = memorySnapshot();
+    long long rssPeak = 0;
+    for (const PhaseTiming& t : stats.phases) rssPeak = max(rssPeak, t.rssPeakBytes);
+    auto perItem = [](long long bytes, long long items) { return items > 0 ? double(bytes) / double(items) : 0.0; };
+    const SubsystemMemory* sub = snap.subsystems;
+
+    out << "  \"memory\": {\"hook\": " << (memoryHookInstalled() ? "true" : "false")
+        << ", \"heap_bytes\": " << snap.heapBytes << ", \"heap_peak_bytes\": " << snap.heapPeakBytes
+        << ", \"rss_bytes\": " << currentRssBytes() << ", \"rss_peak_bytes\": " << rssPeak << ",\n";
+    out << "    \"subsystems\": {\n";
+    for (int s = 0; s < MEM_SUBSYSTEM_COUNT; s++) {
+        out << "      \"" << memorySubsystemName((MemorySubsystem)s) << "\": {\"current_bytes\": " << sub[s].currentBytes
+            << ", \"peak_bytes\": " << sub[s].peakBytes << ", \"allocated_bytes\": " << sub[s].allocatedBytes
+            << ", \"allocations\": " << sub[s].allocations << "}" << (s + 1 < MEM_SUBSYSTEM_COUNT ? ",\n" : "\n");
+    }
+    out << "    },\n";
+    out << "    \"bytes_per_component\": " << perItem(sub[MEM_COMPONENTS].currentBytes, stats.components)
+        << ", \"bytes_per_node\": "
+        << perItem(sub[MEM_NAME_TABLE].currentBytes + sub[MEM_RESULTS].currentBytes, stats.nodes)
+        << ", \"peak_bytes_per_node\": " << perItem(snap.heapPeakBytes, stats.nodes) << "\n";
+    out << "  },\n";
+}
+
+
+// SolverStats Implementation
+
+void SolverStats::resetSolve() {
+    for (int p = PHASE_ASSEMBLY; p <= PHASE_OUTPUT; p++) phases[p] = PhaseTiming();
+    unknowns = 0;
+    nnzA = nnzL = 0;
+    supernodes = 0;
+    iterations = 0;
+    backend.clear();
+}
+
+bool SolverStats::enableHardwareCounters() {
+    auto opened = make_shared<PerfCounters>();
+    if (!opened->available()) {
+        counters.reset();
+        countersReason = opened->unavailableReason();
+        return false;
+    }
+    counters = opened;
+    countersReason.clear();
+    return true;
+}
+
+double SolverStats::totalSeconds() const {
+    double total = 0;
+    for (const PhaseTiming& t : phases) total += t.wallSeconds;
+    return total;
+}
+
+void SolverStats::writeJson(ostream& out) const {
+    ios::fmtflags oldFlags = out.flags();
+    streamsize oldPrecision = out.precision(9);
+    out << defaultfloat;
+
+    out << "{\n  \"phases\": {\n";
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        const PhaseTiming& t = phases[p];
+        out << "    \"" << phaseName((StatPhase)p) << "\": {\"wall_s\": " << t.wallSeconds
+            << ", \"cpu_s\": " << t.cpuSeconds << ", \"calls\": " << t.calls;
+        if (t.flops > 0 && t.wallSeconds > 0) out << ", \"gflops\": " << t.flops / t.wallSeconds * 1e-9;
+        if (trackMemory) out << ", \"heap_peak_bytes\": " << t.heapPeakBytes << ", \"rss_peak_bytes\": " << t.rssPeakBytes;
+        writeCounters(out, t);
+        out << "}" << (p + 1 < PHASE_COUNT ? ",\n" : "\n");
+    }
+    out << "  },\n";
+    out << "  \"total_wall_s\": " << totalSeconds() << ",\n";
+    out << "  \"counts\": {\"components\": " << components << ", \"nodes\": " << nodes
+        << ", \"unknowns\": " << unknowns << ", \"nnz\": " << nnzA << ", \"nnz_factor\": " << nnzL
+        << ", \"fill_ratio\": " << fillRatio()
+        << ", \"supernodes\": " << supernodes << ", \"iterations\": " << iterations << "},\n";
+    out << "  \"hardware_counters\": {\"available\": " << (counters ? "true" : "false");
+    if (!countersReason.empty()) out << ", \"reason\": \"" << jsonEscape(countersReason) << "\"";
+    out << "},\n";
+    if (trackMemory) writeMemory(out, *this);
+    out << "  \"backend\": \"" << backend << "\"\n}\n";
+
+    out.flags(oldFlags);
+    out.precision(oldPrecision);
+}
@@ -0,0 +1,172 @@
+#ifndef SOLVER_STATS_H
+#define SOLVER_STATS_H
+
+#include <string>
+#include <iostream>
+#include <chrono>
+#include <ctime>
+#include <memory>
+#include <algorithm>
+#include "PerfCounters.h"
+#include "TraceRecorder.h"
+#include "MemoryTracker.h"
+
+using namespace std;
+
+
+// 1. Phase Timing
+
+
+// Phases of a load -> solve -> output run. Timers wrap whole phases (or
+// batches of work, as in loadCircuit), never single elements, so enabling
+// them costs two clock reads per phase.
+enum StatPhase {
+    PHASE_LOAD,             // Reading and tokenizing the netlist
+    PHASE_INTERNING,        // Node names -> IDs, component creation
+    PHASE_ASSEMBLY,         // MNA or reduced nodal system
+    PHASE_ORDERING,         // Fill-reducing ordering and symbolic analysis
+    PHASE_FACTORIZATION,    // Numeric factorization (dense, sparse or multigrid setup)
+    PHASE_TRIANGULAR_SOLVE, // Forward/backward substitution
+    PHASE_ITERATIVE_SOLVE,  // Conjugate gradient iterations
+    PHASE_OUTPUT,           // Printing or saving results
+    PHASE_COUNT
+};
+
+const char* phaseName(StatPhase phase);
+
+// Memory subsystem charged for the allocations of a phase (see MemoryScope)
+inline MemorySubsystem phaseMemorySubsystem(StatPhase phase) {
+    switch (phase) {
+        case PHASE_INTERNING: return MEM_COMPONENTS;
+        case PHASE_ASSEMBLY: return MEM_MATRIX;
+        case PHASE_ORDERING:
+        case PHASE_FACTORIZATION:
+        case PHASE_TRIANGULAR_SOLVE:
+        case PHASE_ITERATIVE_SOLVE: return MEM_FACTORS;
+        default: return MEM_OTHER;
+    }
+}
+
+struct PhaseTiming {
+    double wallSeconds = 0;
+    double cpuSeconds = 0; // Process CPU time, so it includes helper threads
+    long long calls = 0;
+    double flops = 0;      // Floating-point work done, where the solver knows it
+
+    // Hardware counter deltas (only with enableHardwareCounters)
+    double events[HW_EVENT_COUNT] = {};
+    bool eventValid[HW_EVENT_COUNT] = {};
+
+    // Highest tracked heap and RSS seen during the phase (memory tracking only)
+    long long heapPeakBytes = 0;
+    long long rssPeakBytes = 0;
+};
+
+struct SolverStats {
+    bool enabled = false;
+    PhaseTiming phases[PHASE_COUNT];
+
+    // Hardware counters of the thread that enabled them, read around every
+    // phase. Null when disabled or unavailable (see countersReason).
+    shared_ptr<PerfCounters> counters;
+    string countersReason;
+
+    // Per-phase heap/RSS peaks and the subsystem breakdown in the report
+    bool trackMemory = false;
+
+    // Problem counts from the last load and solve
+    long long components = 0;
+    int nodes = 0;
+    int unknowns = 0;      // Dimension of the system actually solved
+    long long nnzA = 0;    // Stored entries of the system matrix
+    long long nnzL = 0;    // Entries of the factor (0 for iterative solves)
+    int supernodes = 0;
+    int iterations = 0;    // CG iterations (0 for direct solves)
+    string backend;
+
+    // Clear everything after loading (assembly .. output) and the solve
+    // counts, so a re-solve does not add to the previous one
+    void resetSolve();
+    void reset() {
+        SolverStats fresh;
+        fresh.enabled = enabled;
+        fresh.counters = counters;
+        fresh.countersReason = countersReason;
+        fresh.trackMemory = trackMemory;
+        *this = fresh;
+    }
+
+    // Returns false (and records why) when counters cannot be opened
+    bool enableHardwareCounters();
+
+    void addFlops(StatPhase phase, double flops) { if (enabled) phases[phase].flops += flops; }
+
+    // Wall time of all phases
+    double totalSeconds() const;
+
+    // Factor entries per entry of A's lower triangle (nnzA stores both)
+    double fillRatio() const {
+        long long lower = (nnzA + unknowns) / 2;
+        return lower > 0 && nnzL > 0 ? double(nnzL) / double(lower) : 0.0;
+    }
+
+    void writeJson(ostream& out) const;
+};
+
+// Adds the wall and CPU time of its scope to one phase. With a trace
+// session active it also marks the phase on the timeline, and with memory
+// tracking on it charges the scope's allocations to the phase's memory
+// subsystem. With all three off it costs two flag reads.
+class ScopedPhase {
+private:
+    SolverStats* stats;
+    StatPhase phase;
+    bool tracing;  // Trace session active at construction
+    bool tagging;  // Memory tracking on at construction
+    MemorySubsystem previousSubsystem = MEM_OTHER;
+    chrono::steady_clock::time_point wallStart;
+    clock_t cpuStart = 0;
+    CounterSample countersStart;
+
+    void record() {
+        PhaseTiming& t = stats->phases[phase];
+        t.wallSeconds += chrono::duration<double>(chrono::steady_clock::now() - wallStart).count();
+        t.cpuSeconds += double(clock() - cpuStart) / CLOCKS_PER_SEC;
+        t.calls++;
+        if (stats->trackMemory) {
+            t.heapPeakBytes = max(t.heapPeakBytes, phaseHeapPeakBytes());
+            t.rssPeakBytes = max(t.rssPeakBytes, peakRssBytes());
+        }
+        if (!stats->counters) return;
+        CounterSample end = stats->counters->read();
+        for (int e = 0; e < HW_EVENT_COUNT; e++) {
+            if (!countersStart.valid[e] || !end.valid[e]) continue;
+            t.events[e] += end.value[e] - countersStart.value[e];
+            t.eventValid[e] = true;
+        }
+    }
+
+public:
+    ScopedPhase(SolverStats& s, StatPhase p)
+        : stats(s.enabled ? &s : nullptr), phase(p), tracing(tracingActive()), tagging(memoryTrackingEnabled()) {
+        if (tracing) traceEvent('B', phaseName(p), "phase");
+        if (tagging) {
+            previousSubsystem = currentMemorySubsystem;
+            currentMemorySubsystem = phaseMemorySubsystem(p);
+        }
+        if (!stats) return;
+        if (stats->trackMemory) beginMemoryPhase();
+        if (stats->counters) countersStart = stats->counters->read();
+        wallStart = chrono::steady_clock::now();
+        cpuStart = clock();
+    }
+    ~ScopedPhase() {
+        if (stats) record();
+        if (tagging) currentMemorySubsystem = previousSubsystem;
+        if (tracing) traceEvent('E', phaseName(phase), "phase");
+    }
+    ScopedPhase(const ScopedPhase&) = delete;
+    ScopedPhase& operator=(const ScopedPhase&) = delete;
+};
+
+#endif // SOLVER_STATS_H
@@ -0,0 +1,1515 @@
+#include "SparseSolver.h"
+#include "TraceRecorder.h"
+#include <vector>
+#include <queue>
+#include <numeric>
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <fstream>
+#include <future>
+#include <mutex>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <atomic>
+#include <filesystem>
+#include <random>
+#include <cerrno>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define CIRCUIT_HAVE_MMAP 1
+#endif
+
+using namespace std;
+
+const char* const SINGULAR_MESSAGE =
+    "Singular Matrix detected! The circuit may have floating nodes, no ground reference, or invalid loops.";
+
+
+// Helper: Build CSC from Triplets
+
+SparseMatrix buildFromTriplets(int n, const vector<int>& rows, const vector<int>& cols,
+                               const vector<double>& vals) {
+    // Bucket the triplets by column
+    vector<int> start(n + 1, 0);
+    for (int c : cols) start[c + 1]++;
+    for (int j = 0; j < n; j++) start[j + 1] += start[j];
+
+    vector<pair<int, double>> bucket(rows.size());
+    vector<int> next(start.begin(), start.end() - 1);
+    for (size_t k = 0; k < rows.size(); k++) {
+        bucket[next[cols[k]]++] = {rows[k], vals[k]};
+    }
+
+    // Sort every column by row and merge duplicates (parallel stamps add up)
+    SparseMatrix M;
+    M.n = n;
+    M.colPtr.assign(n + 1, 0);
+    M.rowIdx.reserve(rows.size());
+    M.values.reserve(rows.size());
+    for (int j = 0; j < n; j++) {
+        sort(bucket.begin() + start[j], bucket.begin() + start[j + 1],
+             [](const pair<int, double>& a, const pair<int, double>& b) { return a.first < b.first; });
+        for (int p = start[j]; p < start[j + 1]; p++) {
+            if (!M.rowIdx.empty() && (int)M.rowIdx.size() > M.colPtr[j] && M.rowIdx.back() == bucket[p].first) {
+                M.values.back() += bucket[p].second;
+            } else {
+                M.rowIdx.push_back(bucket[p].first);
+                M.values.push_back(bucket[p].second);
+            }
+        }
+        M.colPtr[j + 1] = (int)M.rowIdx.size();
+    }
+    return M;
+}
+
+
+// Helper: Matrix Hash
+// Word-at-a-time multiply-xorshift: fast enough to run before every solve
+// with a factor cache; the cache compares A itself before trusting a hit.
+
+static unsigned long long hashWords(unsigned long long h, const void* data, size_t bytes) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    for (; bytes >= 8; bytes -= 8, p += 8) {
+        unsigned long long w;
+        memcpy(&w, p, 8);
+        h = (h ^ w) * 0x9E3779B97F4A7C15ull;
+        h ^= h >> 29;
+    }
+    for (; bytes > 0; bytes--, p++) h = (h ^ *p) * 0x100000001B3ull;
+    return h;
+}
+
+unsigned long long matrixHash(const SparseMatrix& A) {
+    unsigned long long h = 0xCBF29CE484222325ull;
+    h = hashWords(h, &A.n, sizeof(A.n));
+    h = hashWords(h, A.colPtr.data(), A.colPtr.size() * sizeof(int));
+    h = hashWords(h, A.rowIdx.data(), A.rowIdx.size() * sizeof(int));
+    h = hashWords(h, A.values.data(), A.values.size() * sizeof(double));
+    h ^= h >> 32;
+    return h * 0xD6E8FEB86659FD93ull ^ (h >> 31);
+}
+
+
+// replaceFile() - Write Aside, Rename into Place
+
+void replaceFile(const string& path, const string& what, const function<void(ostream&)>& write) {
+    // Process ID and a per-process counter name the temporary file; it is
+    // created exclusively, so no other writer can be sharing it
+    static atomic<unsigned> counter{0};
+#ifdef CIRCUIT_HAVE_MMAP
+    string partial;
+    int fd = -1;
+    for (int attempt = 0; fd < 0 && attempt < 100; attempt++) {
+        partial = path + "." + to_string((long long)getpid()) + "." + to_string(counter++) + ".partial";
+        fd = open(partial.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0644);
+        if (fd < 0 && errno != EEXIST) break;
+    }
+    if (fd < 0) throw runtime_error("Could not create " + what + " " + partial);
+    close(fd);
+#else
+    string partial = path + "." + to_string(random_device{}()) + "." + to_string(counter++) + ".partial";
+#endif
+    {
+        ofstream out(partial, ios::binary | ios::trunc);
+        if (!out) {
+            remove(partial.c_str());
+            throw runtime_error("Could not create " + what + " " + partial);
+        }
+        try {
+            write(out);
+        } catch (...) {
+            out.close();
+            remove(partial.c_str());
+            throw;
+        }
+        out.close();
+        if (!out) {
+            remove(partial.c_str());
+            throw runtime_error("Could not write " + what + " (disk full?): " + partial);
+        }
+    }
+    error_code ec;
+    filesystem::rename(partial, path, ec);
+    if (ec) {
+        remove(partial.c_str());
+        throw runtime_error("Could not move " + what + " into place: " + path);
+    }
+}
+
+
+// NodalSystem::expand()
+
+vector<double> NodalSystem::expand(const vector<double>& x) const {
+    vector<double> v(nodeToUnknown.size());
+    for (size_t i = 0; i < v.size(); i++) {
+        int u = nodeToUnknown[i];
+        v[i] = (u >= 0 ? x[u] : 0.0) + nodeOffset[i];
+    }
+    return v;
+}
+
+
+// buildNodalSystem() Implementation
+
+NodalSystem buildNodalSystem(const Circuit& circuit) {
+    int nodes = circuit.getNodeCount() + 1; // Node IDs run 0..nodeCount
+
+    // Weighted union-find over voltage sources: pot[i] = V(i) - V(uf[i]).
+    // Ground (ID 0) is always kept as the root of its tree.
+    vector<int> uf(nodes);
+    iota(uf.begin(), uf.end(), 0);
+    vector<double> pot(nodes, 0.0);
+    vector<int> path;
+
+    auto find = [&](int i) {
+        path.clear();
+        while (uf[i] != i) { path.push_back(i); i = uf[i]; }
+        // Compress from the node closest to the root downwards
+        for (int k = (int)path.size() - 1; k >= 0; k--) {
+            int node = path[k];
+            if (uf[node] != i) pot[node] += pot[uf[node]];
+            uf[node] = i;
+        }
+        return i;
+    };
+
+    for (const auto& comp : circuit.getComponents()) {
+        if (comp->getType() != VOLTAGE_SOURCE) continue;
+        int p = comp->nodeA_ID, n = comp->nodeB_ID;
+        int rp = find(p), rn = find(n);
+        if (rp == rn) {
+            throw runtime_error("Voltage source loop at '" + comp->name +
+                                "'! Voltage sources in a closed loop (or in parallel) make the circuit unsolvable.");
+        }
+        double link = comp->value - pot[p] + pot[n]; // V(rp) - V(rn)
+        if (rp == 0) { uf[rn] = rp; pot[rn] = -link; }
+        else { uf[rp] = rn; pot[rp] = link; }
+    }
+
+    // One unknown per voltage-source tree that does not reach ground
+    NodalSystem sys;
+    sys.nodeToUnknown.assign(nodes, -1);
+    sys.nodeOffset.assign(nodes, 0.0);
+    vector<int> rootUnknown(nodes, -1);
+    for (int i = 0; i < nodes; i++) {
+        int r = find(i);
+        sys.nodeOffset[i] = (i == r) ? 0.0 : pot[i];
+        if (r == 0) continue;
+        if (rootUnknown[r] == -1) rootUnknown[r] = sys.unknowns++;
+        sys.nodeToUnknown[i] = rootUnknown[r];
+    }
+
+    // Stamp conductances; currents through fixed offsets move to the RHS
+    vector<int> rows, cols;
+    vector<double> vals;
+    vector<char> grounded(sys.unknowns, 0); // Has a resistor to a fixed node
+    sys.b.assign(sys.unknowns, 0.0);
+    auto add = [&](int i, int j, double g) { rows.push_back(i); cols.push_back(j); vals.push_back(g); };
+
+    for (const auto& comp : circuit.getComponents()) {
+        int a = comp->nodeA_ID, b = comp->nodeB_ID;
+        int ua = sys.nodeToUnknown[a], ub = sys.nodeToUnknown[b];
+        double oa = sys.nodeOffset[a], ob = sys.nodeOffset[b];
+
+        if (comp->getType() == RESISTOR) {
+            if (ua >= 0 && ua == ub) continue; // Current stays inside one supernode
+            double g = static_cast<const Resistor*>(comp.get())->getConductance();
+            if (ua >= 0) { add(ua, ua, g); sys.b[ua] -= g * (oa - ob); if (ub >= 0) add(ua, ub, -g); else grounded[ua] = 1; }
+            if (ub >= 0) { add(ub, ub, g); sys.b[ub] -= g * (ob - oa); if (ua >= 0) add(ub, ua, -g); else grounded[ub] = 1; }
+        }
+        else if (comp->getType() == CURRENT_SOURCE) {
+            if (ua >= 0) sys.b[ua] -= comp->value;
+            if (ub >= 0) sys.b[ub] += comp->value;
+        }
+    }
+
+    sys.A = buildFromTriplets(sys.unknowns, rows, cols, vals);
+
+    // Every connected group of unknowns needs a resistive path to ground,
+    // otherwise its voltage is undetermined and A is singular
+    vector<char> seen(sys.unknowns, 0);
+    vector<int> stack;
+    for (int s = 0; s < sys.unknowns; s++) {
+        if (seen[s]) continue;
+        bool reachesGround = false;
+        seen[s] = 1;
+        stack.push_back(s);
+        while (!stack.empty()) {
+            int v = stack.back();
+            stack.pop_back();
+            if (grounded[v]) reachesGround = true;
+            for (int p = sys.A.colPtr[v]; p < sys.A.colPtr[v + 1]; p++) {
+                int u = sys.A.rowIdx[p];
+                if (!seen[u]) { seen[u] = 1; stack.push_back(u); }
+            }
+        }
+        if (!reachesGround) sys.floatingGroups++;
+    }
+    return sys;
+}
+
+
+// Orderings
+
+vector<int> naturalOrdering(const SparseMatrix& A) {
+    vector<int> perm(A.n);
+    iota(perm.begin(), perm.end(), 0);
+    return perm;
+}
+
+vector<int> invertPermutation(const vector<int>& perm) {
+    vector<int> pinv(perm.size());
+    for (size_t k = 0; k < perm.size(); k++) pinv[perm[k]] = (int)k;
+    return pinv;
+}
+
+// Helper: breadth-first level structure from 'start'. Returns the nodes in
+// visit order and reports the number of levels and the nodes of the last
+// level through the out-parameters. 'stamp' lets callers reuse 'seen'.
+static vector<int> bfsLevels(const SparseMatrix& A, int start, vector<int>& seen, int stamp,
+                             int& levels, vector<int>& lastLevel) {
+    vector<int> order;
+    order.push_back(start);
+    seen[start] = stamp;
+    size_t levelBegin = 0;
+    levels = 0;
+    while (levelBegin < order.size()) {
+        size_t levelEnd = order.size();
+        lastLevel.assign(order.begin() + levelBegin, order.begin() + levelEnd);
+        levels++;
+        for (size_t q = levelBegin; q < levelEnd; q++) {
+            int v = order[q];
+            for (int p = A.colPtr[v]; p < A.colPtr[v + 1]; p++) {
+                int u = A.rowIdx[p];
+                if (seen[u] != stamp) { seen[u] = stamp; order.push_back(u); }
+            }
+        }
+        levelBegin = levelEnd;
+    }
+    return order;
+}
+
+// Helper: George-Liu pseudo-peripheral node search within start's component
+static int pseudoPeripheralNode(const SparseMatrix& A, int start, vector<int>& seen, int& stamp, int& levels) {
+    auto degree = [&](int v) { return A.colPtr[v + 1] - A.colPtr[v]; };
+    vector<int> lastLevel;
+    bfsLevels(A, start, seen, ++stamp, levels, lastLevel);
+    while (true) {
+        int best = lastLevel[0];
+        for (int v : lastLevel) if (degree(v) < degree(best)) best = v;
+        int newLevels;
+        vector<int> newLast;
+        bfsLevels(A, best, seen, ++stamp, newLevels, newLast);
+        if (newLevels <= levels) return start;
+        start = best;
+        levels = newLevels;
+        lastLevel = newLast;
+    }
+}
+
+int pseudoDiameter(const SparseMatrix& A) {
+    vector<int> seen(A.n, 0), component(A.n, 0);
+    int stamp = 0, diameter = 0;
+    for (int s = 0; s < A.n; s++) {
+        if (component[s]) continue;
+        int levels;
+        int root = pseudoPeripheralNode(A, s, seen, stamp, levels);
+        diameter = max(diameter, levels - 1);
+        // Flag the whole component so it is only measured once
+        vector<int> lastLevel;
+        for (int v : bfsLevels(A, root, seen, ++stamp, levels, lastLevel)) component[v] = 1;
+    }
+    return diameter;
+}
+
+vector<int> rcmOrdering(const SparseMatrix& A) {
+    int n = A.n;
+    auto degree = [&](int v) { return A.colPtr[v + 1] - A.colPtr[v]; };
+    vector<int> seen(n, 0), perm;
+    vector<bool> placed(n, false);
+    perm.reserve(n);
+    int stamp = 0;
+
+    for (int s = 0; s < n; s++) {
+        if (placed[s]) continue;
+        int levels;
+        int root = pseudoPeripheralNode(A, s, seen, stamp, levels);
+
+        // Cuthill-McKee: BFS visiting neighbours by increasing degree
+        size_t head = perm.size();
+        perm.push_back(root);
+        placed[root] = true;
+        vector<int> nbrs;
+        while (head < perm.size()) {
+            int v = perm[head++];
+            nbrs.clear();
+            for (int p = A.colPtr[v]; p < A.colPtr[v + 1]; p++) {
+                int u = A.rowIdx[p];
+                if (!placed[u]) { placed[u] = true; nbrs.push_back(u); }
+            }
+            stable_sort(nbrs.begin(), nbrs.end(), [&](int x, int y) { return degree(x) < degree(y); });
+            perm.insert(perm.end(), nbrs.begin(), nbrs.end());
+        }
+    }
+    reverse(perm.begin(), perm.end());
+    return perm;
+}
+
+vector<int> minimumDegreeOrdering(const SparseMatrix& A) {
+    int n = A.n;
+
+    // Quotient graph: an eliminated node becomes an "element" whose variable
+    // list stands for the clique its elimination created. Absorbed elements
+    // are freed, so memory stays O(nnz(A)) instead of growing with the fill.
+    vector<vector<int>> varAdj(n), elemAdj(n), elemVars(n);
+    for (int j = 0; j < n; j++) {
+        for (int p = A.colPtr[j]; p < A.colPtr[j + 1]; p++) {
+            if (A.rowIdx[p] != j) varAdj[j].push_back(A.rowIdx[p]);
+        }
+    }
+
+    // Degree buckets (doubly linked lists), so a degree update is O(1) and
+    // memory stays O(n); a lazy heap would grow with the fill instead
+    vector<int> degree(n), head(max(n, 1), -1), next(n, -1), prev(n, -1);
+    int minDegree = 0;
+    auto insert = [&](int u) {
+        int d = degree[u];
+        prev[u] = -1;
+        next[u] = head[d];
+        if (head[d] >= 0) prev[head[d]] = u;
+        head[d] = u;
+        minDegree = min(minDegree, d);
+    };
+    auto unlink = [&](int u) {
+        if (prev[u] >= 0) next[prev[u]] = next[u];
+        else head[degree[u]] = next[u];
+        if (next[u] >= 0) prev[next[u]] = prev[u];
+    };
+    for (int j = n - 1; j >= 0; j--) {
+        degree[j] = (int)varAdj[j].size();
+        insert(j);
+    }
+
+    vector<char> eliminated(n, 0), absorbed(n, 0);
+    vector<long long> mark(n, 0), wMark(n, 0);
+    vector<int> w(n, 0);
+    long long stamp = 0;
+    vector<int> perm;
+    perm.reserve(n);
+    while ((int)perm.size() < n) {
+        while (head[minDegree] < 0) minDegree++;
+        int v = head[minDegree];
+        unlink(v);
+        perm.push_back(v);
+        eliminated[v] = 1;
+
+        // Pattern of the new element: v's variables plus its elements' variables
+        mark[v] = ++stamp;
+        vector<int> pattern;
+        for (int u : varAdj[v]) {
+            if (!eliminated[u] && mark[u] != stamp) { mark[u] = stamp; pattern.push_back(u); }
+        }
+        for (int e : elemAdj[v]) {
+            if (absorbed[e]) continue;
+            for (int u : elemVars[e]) {
+                if (!eliminated[u] && mark[u] != stamp) { mark[u] = stamp; pattern.push_back(u); }
+            }
+            absorbed[e] = 1;
+            vector<int>().swap(elemVars[e]);
+        }
+        vector<int>().swap(varAdj[v]);
+        vector<int>().swap(elemAdj[v]);
+
+        // Neighbours now reach each other through element v
+        long long patternStamp = stamp;
+        for (int u : pattern) {
+            auto& elems = elemAdj[u];
+            elems.erase(remove_if(elems.begin(), elems.end(), [&](int e) { return absorbed[e] != 0; }), elems.end());
+            elems.push_back(v);
+            auto& vars = varAdj[u];
+            vars.erase(remove_if(vars.begin(), vars.end(),
+                                 [&](int w) { return eliminated[w] || mark[w] == patternStamp; }),
+                       vars.end());
+        }
+
+        // Approximate external degree (as in AMD): each older element e adds
+        // |Le \ Lp| once instead of merging the sets. Elements entirely
+        // inside Lp are absorbed on the spot.
+        elemVars[v].swap(pattern);
+        const vector<int>& Lp = elemVars[v];
+        ++stamp;
+        for (int u : Lp) {
+            for (int e : elemAdj[u]) {
+                if (e == v) continue;
+                if (wMark[e] != stamp) { wMark[e] = stamp; w[e] = (int)elemVars[e].size(); }
+                w[e]--;
+            }
+        }
+        long long remaining = n - (long long)perm.size();
+        for (int u : Lp) {
+            long long d = (long long)varAdj[u].size() + (long long)Lp.size() - 1;
+            for (int e : elemAdj[u]) {
+                if (e == v || absorbed[e]) continue;
+                if (w[e] == 0) { absorbed[e] = 1; vector<int>().swap(elemVars[e]); continue; }
+                d += w[e];
+            }
+            d = min(d, (long long)degree[u] + (long long)Lp.size() - 1);
+            d = min(d, remaining - 1);
+            unlink(u);
+            degree[u] = (int)max(d, 0LL);
+            insert(u);
+        }
+    }
+    return perm;
+}
+
+
+// Symbolic Analysis
+
+int bandwidthUnder(const SparseMatrix& A, const vector<int>& perm) {
+    vector<int> pinv = invertPermutation(perm);
+    int bw = 0;
+    for (int j = 0; j < A.n; j++) {
+        for (int p = A.colPtr[j]; p < A.colPtr[j + 1]; p++) {
+            bw = max(bw, abs(pinv[A.rowIdx[p]] - pinv[j]));
+        }
+    }
+    return bw;
+}
+
+SymbolicFactor symbolicAnalysis(const SparseMatrix& A, const vector<int>& perm) {
+    int n = A.n;
+    SymbolicFactor sym;
+    sym.perm = perm;
+    vector<int> pinv = invertPermutation(perm);
+
+    // Elimination tree of C = P A P^T (Liu's algorithm with path compression)
+    sym.parent.assign(n, -1);
+    vector<int> ancestor(n, -1);
+    for (int k = 0; k < n; k++) {
+        int col = perm[k];
+        for (int p = A.colPtr[col]; p < A.colPtr[col + 1]; p++) {
+            int i = pinv[A.rowIdx[p]];
+            while (i != -1 && i < k) {
+                int next = ancestor[i];
+                ancestor[i] = k;
+                if (next == -1) sym.parent[i] = k;
+                i = next;
+            }
+        }
+    }
+
+    // Column counts: row k of L is the union of etree paths from each
+    // off-diagonal entry of row k up to k (the "row subtree")
+    sym.colCount.assign(n, 1);
+    vector<int> mark(n, -1);
+    for (int k = 0; k < n; k++) {
+        mark[k] = k;
+        int col = perm[k];
+        for (int p = A.colPtr[col]; p < A.colPtr[col + 1]; p++) {
+            int j = pinv[A.rowIdx[p]];
+            if (j >= k) continue;
+            while (mark[j] != k) {
+                sym.colCount[j]++;
+                mark[j] = k;
+                j = sym.parent[j];
+            }
+        }
+    }
+
+    for (int j = 0; j < n; j++) {
+        long long c = sym.colCount[j];
+        sym.nnzL += c;
+        sym.flops += (double)c * (double)c;
+        sym.maxColCount = max(sym.maxColCount, sym.colCount[j]);
+    }
+    sym.bandwidth = bandwidthUnder(A, perm);
+    return sym;
+}
+
+
+// Supernodal Structure
+
+SupernodalStructure analyzeSupernodal(const SparseMatrix& A, const SymbolicFactor& sym) {
+    int n = A.n;
+    SupernodalStructure S;
+    S.n = n;
+    S.flops = sym.flops;
+
+    // Postorder the elimination tree (children in increasing order)
+    vector<int> head(n, -1), next(n, -1), post, stack;
+    post.reserve(n);
+    for (int j = n - 1; j >= 0; j--) {
+        if (sym.parent[j] != -1) { next[j] = head[sym.parent[j]]; head[sym.parent[j]] = j; }
+    }
+    for (int root = 0; root < n; root++) {
+        if (sym.parent[root] != -1) continue;
+        stack.push_back(root);
+        while (!stack.empty()) {
+            int p = stack.back();
+            int child = head[p];
+            if (child == -1) { stack.pop_back(); post.push_back(p); }
+            else { head[p] = next[child]; stack.push_back(child); }
+        }
+    }
+
+    // Renumber columns in postorder; fill and the tree shape are unchanged
+    vector<int> postInv = invertPermutation(post);
+    vector<int> parent(n), colCount(n);
+    S.perm.resize(n);
+    for (int k = 0; k < n; k++) {
+        int old = post[k];
+        S.perm[k] = sym.perm[old];
+        parent[k] = sym.parent[old] == -1 ? -1 : postInv[sym.parent[old]];
+        colCount[k] = sym.colCount[old];
+    }
+
+    // Fundamental supernodes: column j continues j-1's supernode when j is
+    // its parent and L(:, j-1) is exactly L(:, j) plus the diagonal
+    S.snodeStart.push_back(0);
+    for (int j = 1; j < n; j++) {
+        if (!(parent[j - 1] == j && colCount[j - 1] == colCount[j] + 1)) S.snodeStart.push_back(j);
+    }
+    if (n > 0) S.snodeStart.push_back(n);
+    int ns = S.supernodes();
+
+    vector<int> snodeOf(n);
+    for (int s = 0; s < ns; s++) {
+        for (int j = S.snodeStart[s]; j < S.snodeStart[s + 1]; j++) snodeOf[j] = s;
+    }
+    S.snodeParent.assign(ns, -1);
+    vector<int> childHead(ns, -1), childNext(ns, -1);
+    for (int s = ns - 1; s >= 0; s--) {
+        int last = S.snodeStart[s + 1] - 1;
+        if (parent[last] == -1) continue;
+        S.snodeParent[s] = snodeOf[parent[last]];
+        childNext[s] = childHead[S.snodeParent[s]];
+        childHead[S.snodeParent[s]] = s;
+    }
+
+    // Row structure: own columns, then rows contributed by A and by children
+    vector<int> pinv = invertPermutation(S.perm);
+    vector<int> mark(n, -1), extra;
+    S.rowPtr.assign(ns + 1, 0);
+    S.panelPtr.assign(ns + 1, 0);
+    long long stackNow = 0;
+    for (int s = 0; s < ns; s++) {
+        int f = S.snodeStart[s], l = S.snodeStart[s + 1] - 1;
+        extra.clear();
+        for (int j = f; j <= l; j++) {
+            int col = S.perm[j];
+            for (int p = A.colPtr[col]; p < A.colPtr[col + 1]; p++) {
+                int i = pinv[A.rowIdx[p]];
+                if (i > l && mark[i] != s) { mark[i] = s; extra.push_back(i); }
+            }
+        }
+        for (int c = childHead[s]; c != -1; c = childNext[c]) {
+            for (long long q = S.rowPtr[c] + S.cols(c); q < S.rowPtr[c + 1]; q++) {
+                int i = S.rowIdx[q];
+                if (i > l && mark[i] != s) { mark[i] = s; extra.push_back(i); }
+            }
+            long long u = S.rows(c) - S.cols(c);
+            stackNow -= u * u;
+        }
+        sort(extra.begin(), extra.end());
+        for (int j = f; j <= l; j++) S.rowIdx.push_back(j);
+        S.rowIdx.insert(S.rowIdx.end(), extra.begin(), extra.end());
+        S.rowPtr[s + 1] = (long long)S.rowIdx.size();
+
+        long long m = S.rows(s), k = S.cols(s);
+        S.panelPtr[s + 1] = S.panelPtr[s] + m * k;
+        S.maxFront = max(S.maxFront, (int)m);
+        stackNow += (m - k) * (m - k);
+        S.maxStackEntries = max(S.maxStackEntries, stackNow);
+    }
+    S.factorEntries = S.panelPtr[ns];
+    return S;
+}
+
+
+// Subtree Partition for Parallel Factorization
+
+SubtreePartition partitionSubtrees(const SupernodalStructure& S, int width) {
+    SubtreePartition P;
+    int ns = S.supernodes();
+    if (width < 2 || ns < 2) return P;
+
+    // Flops and size of every subtree (children come before their parents)
+    vector<double> subtreeFlops(ns, 0.0);
+    vector<int> subtreeSize(ns, 1);
+    for (int s = 0; s < ns; s++) {
+        int k = S.cols(s), m = S.rows(s);
+        for (int c = 0; c < k; c++) subtreeFlops[s] += (double)(m - c) * (double)(m - c);
+        int p = S.snodeParent[s];
+        if (p != -1) { subtreeFlops[p] += subtreeFlops[s]; subtreeSize[p] += subtreeSize[s]; }
+    }
+    double total = 0;
+    for (int s = 0; s < ns; s++) if (S.snodeParent[s] == -1) total += subtreeFlops[s];
+    double grain = total / (4.0 * width);
+
+    // Maximal subtrees within the grain, packed in order until a task has a grain's worth
+    P.owner.assign(ns, -1);
+    double load = 0;
+    for (int r = 0; r < ns; r++) {
+        int p = S.snodeParent[r];
+        if (subtreeFlops[r] > grain || (p != -1 && subtreeFlops[p] <= grain)) continue;
+        if (P.taskRanges.empty() || load >= grain) { P.taskRanges.emplace_back(); load = 0; }
+        int t = P.tasks() - 1;
+        P.taskRanges[t].push_back({r - subtreeSize[r] + 1, r});
+        load += subtreeFlops[r];
+        for (int s = r - subtreeSize[r] + 1; s <= r; s++) P.owner[s] = t;
+    }
+    if (P.tasks() < 2) return SubtreePartition();
+
+    // Workspace of each task: its largest front and its stack peak. Every
+    // child of a task's supernode is in the same task.
+    P.taskFront.assign(P.tasks(), 0);
+    P.taskStack.assign(P.tasks(), 0);
+    vector<long long> top(P.tasks(), 0), childEntries(ns, 0);
+    for (int s = 0; s < ns; s++) {
+        int t = P.owner[s];
+        if (t < 0) continue;
+        long long m = S.rows(s), u = m - S.cols(s);
+        P.taskFront[t] = max(P.taskFront[t], (int)m);
+        top[t] += u * u - childEntries[s];
+        P.taskStack[t] = max(P.taskStack[t], top[t]);
+        if (S.snodeParent[s] != -1) childEntries[S.snodeParent[s]] += u * u;
+    }
+    for (int t = 0; t < P.tasks(); t++) {
+        long long f = P.taskFront[t];
+        P.workspaceEntries += f * f + f + P.taskStack[t] + S.n / 2; // relPos counted as half
+    }
+    return P;
+}
+
+
+// Helper: Out-of-core Panel Writer
+// Double buffering: panels are appended to one block while the previous
+// block is written by a background task, so the factorization only waits
+// when the disk falls a whole block behind.
+
+class PanelFileWriter {
+private:
+    ofstream file;
+    vector<double> filling;
+    vector<double> writing;
+    future<bool> pending;
+    size_t blockDoubles;
+
+    void waitPending() {
+        if (pending.valid() && !pending.get()) throw runtime_error("Out-of-core scratch file write failed (disk full?).");
+    }
+
+    void flush() {
+        if (filling.empty()) return;
+        waitPending();
+        writing.swap(filling);
+        filling.clear();
+        pending = async(launch::async, [this]() {
+            setTraceThreadName("panel writer");
+            TraceScope io("panel_write", "io");
+            file.write(reinterpret_cast<const char*>(writing.data()), writing.size() * sizeof(double));
+            return (bool)file;
+        });
+    }
+
+public:
+    PanelFileWriter(const string& path, size_t blockBytes)
+        : file(path, ios::binary | ios::trunc), blockDoubles(max<size_t>(1, blockBytes / sizeof(double))) {
+        if (!file) throw runtime_error("Could not create out-of-core scratch file " + path);
+        filling.reserve(blockDoubles);
+    }
+
+    ~PanelFileWriter() {
+        if (pending.valid()) pending.wait();
+    }
+
+    void append(const double* data, size_t count) {
+        while (count > 0) {
+            size_t take = min(count, blockDoubles - filling.size());
+            filling.insert(filling.end(), data, data + take);
+            data += take;
+            count -= take;
+            if (filling.size() == blockDoubles) flush();
+        }
+    }
+
+    void finish() {
+        flush();
+        waitPending();
+        file.close();
+        if (!file) throw runtime_error("Out-of-core scratch file write failed (disk full?).");
+    }
+};
+
+// Helper: read the panels of supernodes [first, last) from the scratch file
+static vector<double> readPanels(const string& path, const SupernodalStructure& S, int first, int last) {
+    setTraceThreadName("panel reader");
+    TraceScope io("panel_read", "io", first);
+    vector<double> block(S.panelPtr[last] - S.panelPtr[first]);
+    ifstream in(path, ios::binary);
+    in.seekg((streamoff)(S.panelPtr[first] * sizeof(double)));
+    in.read(reinterpret_cast<char*>(block.data()), block.size() * sizeof(double));
+    if (!in) throw runtime_error("Out-of-core scratch file read failed: " + path);
+    return block;
+}
+
+
+// SparseCholesky Out-of-core Mode
+
+SparseCholesky::~SparseCholesky() {
+    if (!scratchPath.empty()) remove(scratchPath.c_str());
+}
+
+void SparseCholesky::setOutOfCore(const string& path, size_t blockBytes) {
+    if (!scratchPath.empty() && scratchPath != path) remove(scratchPath.c_str());
+    scratchPath = path;
+    ioBlockBytes = max<size_t>(blockBytes, sizeof(double));
+    workspaceReady = false; // No parallel partition out of core
+}
+
+void SparseCholesky::setParallel(ParallelFor runner, int width) {
+    parallel = move(runner);
+    parallelWidth = parallel ? max(1, width) : 1;
+    workspaceReady = false;
+}
+
+
+// SparseCholesky::factorize() - Multifrontal
+
+// Helper: size one thread's frontal workspace
+static void sizeFrontWorkspace(vector<int>& relPos, vector<double>& front, vector<double>& updates,
+                               vector<double>& diagA, int n, int maxFront, long long stackEntries) {
+    relPos.assign(n, 0);
+    front.assign((size_t)maxFront * maxFront, 0.0);
+    updates.assign(stackEntries, 0.0); // Stack of children's update matrices
+    diagA.assign(maxFront, 0.0);
+}
+
+void SparseCholesky::prepareWorkspace() {
+    int n = S.n, ns = S.supernodes();
+    pinv = invertPermutation(S.perm);
+    childHead.assign(ns, -1);
+    childNext.assign(ns, -1);
+    for (int s = ns - 1; s >= 0; s--) {
+        int p = S.snodeParent[s];
+        if (p != -1) { childNext[s] = childHead[p]; childHead[p] = s; }
+    }
+    FrontWorkspace& w = mainWork;
+    sizeFrontWorkspace(w.relPos, w.front, w.updates, w.diagA, n, S.maxFront, S.maxStackEntries);
+
+    partition = (parallel && !isOutOfCore()) ? partitionSubtrees(S, parallelWidth) : SubtreePartition();
+    taskWork.resize(partition.tasks());
+    for (int t = 0; t < partition.tasks(); t++) {
+        FrontWorkspace& tw = taskWork[t];
+        sizeFrontWorkspace(tw.relPos, tw.front, tw.updates, tw.diagA, n, partition.taskFront[t], partition.taskStack[t]);
+    }
+    rootUpdate.assign(partition.tasks() > 0 ? ns : 0, 0);
+    workspaceReady = true;
+}
+
+// Helper: assemble, extend-add, partially factor and store one supernode.
+// Children factorized in the same workspace sit on top of its stack; roots
+// of parallel subtrees left theirs in their own task's stack. Either way the
+// children are added in the same order, so the arithmetic never changes.
+void SparseCholesky::factorSupernode(const SparseMatrix& A, int s, FrontWorkspace& w) {
+    TraceScope task("supernode", "factorization", s);
+    vector<int>& relPos = w.relPos;
+    vector<double>& front = w.front;
+    int f = S.snodeStart[s];
+    int k = S.cols(s), m = S.rows(s), u = m - k;
+    const int* R = &S.rowIdx[S.rowPtr[s]];
+    for (int t = 0; t < m; t++) relPos[R[t]] = t;
+    fill(front.begin(), front.begin() + (size_t)m * m, 0.0);
+
+    // Assemble the original entries of this supernode's columns
+    for (int c = 0; c < k; c++) {
+        int col = S.perm[f + c];
+        w.diagA[c] = 0.0;
+        for (int p = A.colPtr[col]; p < A.colPtr[col + 1]; p++) {
+            int i = pinv[A.rowIdx[p]];
+            if (i < f + c) continue;
+            if (i == f + c) w.diagA[c] = A.values[p];
+            front[relPos[i] + (size_t)c * m] += A.values[p];
+        }
+    }
+
+    // Extend-add the children's update matrices
+    int mine = ownerOf(s);
+    long long childTotal = 0;
+    for (int c = childHead[s]; c != -1; c = childNext[c]) {
+        if (ownerOf(c) != mine) continue;
+        long long uc = S.rows(c) - S.cols(c);
+        childTotal += uc * uc;
+    }
+    long long offset = w.top - childTotal;
+    for (int c = childHead[s]; c != -1; c = childNext[c]) {
+        int uc = S.rows(c) - S.cols(c);
+        const int* Rc = &S.rowIdx[S.rowPtr[c] + S.cols(c)];
+        const double* U;
+        if (ownerOf(c) == mine) {
+            U = &w.updates[offset];
+            offset += (long long)uc * uc;
+        } else {
+            U = &taskWork[ownerOf(c)].updates[rootUpdate[c]];
+        }
+        for (int bcol = 0; bcol < uc; bcol++) {
+            double* fcol = &front[(size_t)relPos[Rc[bcol]] * m];
+            for (int a = bcol; a < uc; a++) fcol[relPos[Rc[a]]] += U[a + (size_t)bcol * uc];
+        }
+    }
+    w.top -= childTotal;
+
+    // Dense partial Cholesky of the first k columns (right-looking)
+    for (int c = 0; c < k; c++) {
+        double* colc = &front[(size_t)c * m];
+        double d = colc[c];
+        if (!(d > 1e-12 * w.diagA[c])) {
+            throw runtime_error(SINGULAR_MESSAGE);
+        }
+        d = sqrt(d);
+        colc[c] = d;
+        double inv = 1.0 / d;
+        for (int r = c + 1; r < m; r++) colc[r] *= inv;
+        for (int c2 = c + 1; c2 < m; c2++) {
+            double t = colc[c2];
+            if (t == 0.0) continue;
+            double* col2 = &front[(size_t)c2 * m];
+            for (int r = c2; r < m; r++) col2[r] -= colc[r] * t;
+        }
+    }
+
+    // Keep the panel (the caller streams it out of core), push the Schur
+    // complement for the parent
+    if (!isOutOfCore()) copy(front.begin(), front.begin() + (size_t)m * k, panels.begin() + S.panelPtr[s]);
+    int p = S.snodeParent[s];
+    if (p != -1 && ownerOf(p) != mine) rootUpdate[s] = w.top;
+    double* U = &w.updates[w.top];
+    for (int bcol = 0; bcol < u; bcol++) {
+        for (int a = bcol; a < u; a++) U[a + (size_t)bcol * u] = front[(k + a) + (size_t)(k + bcol) * m];
+    }
+    w.top += (long long)u * u;
+}
+
+void SparseCholesky::factorize(const SparseMatrix& A, const FactorizationCallback& keepGoing) {
+    int ns = S.supernodes();
+    if (!workspaceReady) prepareWorkspace();
+    unmap();
+    unique_ptr<PanelFileWriter> writer;
+    if (isOutOfCore()) {
+        vector<double>().swap(panels);
+        writer = make_unique<PanelFileWriter>(scratchPath, ioBlockBytes);
+
+        // Group supernodes into read blocks of about ioBlockBytes for solve()
+        long long blockDoubles = (long long)(ioBlockBytes / sizeof(double));
+        chunkStart.assign(1, 0);
+        for (int s = 0; s < ns; s++) {
+            if (S.panelPtr[s + 1] - S.panelPtr[chunkStart.back()] > blockDoubles && s > chunkStart.back()) {
+                chunkStart.push_back(s);
+            }
+        }
+        chunkStart.push_back(ns);
+    } else if ((long long)panels.size() != S.factorEntries) {
+        panels.assign(S.factorEntries, 0.0); // Every panel is overwritten below
+    }
+
+    // Progress in flops of the finished supernodes (tasks report concurrently)
+    double done = 0;
+    mutex doneLock;
+    auto report = [&](int s) {
+        if (!keepGoing) return;
+        lock_guard<mutex> guard(doneLock);
+        int k = S.cols(s), m = S.rows(s);
+        for (int c = 0; c < k; c++) done += (double)(m - c) * (double)(m - c); // As counted in S.flops
+        if (!keepGoing(S.flops > 0 ? min(1.0, done / S.flops) : 1.0)) throw runtime_error(CANCELLED_MESSAGE);
+    };
+
+    // Independent subtrees first, then the top of the tree on this thread
+    if (partition.tasks() > 0) {
+        atomic<bool> failed{false};
+        MemorySubsystem subsystem = currentMemorySubsystem;
+        parallel(partition.tasks(), [&](int t) {
+            MemoryScope memory(subsystem);
+            FrontWorkspace& w = taskWork[t];
+            w.top = 0;
+            try {
+                for (const pair<int, int>& range : partition.taskRanges[t]) {
+                    for (int s = range.first; s <= range.second; s++) {
+                        if (failed.load(memory_order_relaxed)) return;
+                        factorSupernode(A, s, w);
+                        report(s);
+                    }
+                }
+            } catch (...) {
+                failed = true;
+                throw;
+            }
+        });
+    }
+    mainWork.top = 0;
+    for (int s = 0; s < ns; s++) {
+        if (ownerOf(s) != -1) continue;
+        factorSupernode(A, s, mainWork);
+        if (writer) writer->append(mainWork.front.data(), (size_t)S.rows(s) * S.cols(s));
+        report(s);
+    }
+    if (writer) writer->finish();
+}
+
+
+// SparseCholesky::solve()
+
+vector<double> SparseCholesky::solve(const vector<double>& b) const {
+    vector<double> x, work;
+    solve(b, x, work);
+    return x;
+}
+
+void SparseCholesky::solve(const vector<double>& b, vector<double>& x, vector<double>& work) const {
+    int n = S.n, ns = S.supernodes();
+    vector<double>& y = work;
+    y.resize(n);
+    for (int k = 0; k < n; k++) y[k] = b[S.perm[k]];
+
+    auto forward = [&](int s, const double* P) {
+        int f = S.snodeStart[s], k = S.cols(s), m = S.rows(s);
+        const int* R = &S.rowIdx[S.rowPtr[s]];
+        for (int c = 0; c < k; c++) {
+            const double* col = P + (size_t)c * m;
+            double yc = y[f + c] / col[c];
+            y[f + c] = yc;
+            for (int r = c + 1; r < m; r++) y[R[r]] -= col[r] * yc;
+        }
+    };
+    auto backward = [&](int s, const double* P) {
+        int f = S.snodeStart[s], k = S.cols(s), m = S.rows(s);
+        const int* R = &S.rowIdx[S.rowPtr[s]];
+        for (int c = k - 1; c >= 0; c--) {
+            const double* col = P + (size_t)c * m;
+            double sum = y[f + c];
+            for (int r = c + 1; r < m; r++) sum -= col[r] * y[R[r]];
+            y[f + c] = sum / col[c];
+        }
+    };
+
+    if (!isOutOfCore()) {
+        // Forward: L y = P b, then backward: L^T x = y
+        const double* factor = factorData();
+        for (int s = 0; s < ns; s++) forward(s, factor + S.panelPtr[s]);
+        for (int s = ns - 1; s >= 0; s--) backward(s, factor + S.panelPtr[s]);
+    } else {
+        // Stream the blocks in (forward pass) and back out in reverse order,
+        // always reading the next block while the current one is used
+        int chunks = (int)chunkStart.size() - 1;
+        auto load = [&](int c) {
+            return async(launch::async, readPanels, cref(scratchPath), cref(S), chunkStart[c], chunkStart[c + 1]);
+        };
+        for (int pass = 0; pass < 2 && chunks > 0; pass++) {
+            bool fwd = (pass == 0);
+            future<vector<double>> next = load(fwd ? 0 : chunks - 1);
+            for (int i = 0; i < chunks; i++) {
+                int c = fwd ? i : chunks - 1 - i;
+                vector<double> block = next.get();
+                if (i + 1 < chunks) next = load(fwd ? c + 1 : c - 1);
+                long long base = S.panelPtr[chunkStart[c]];
+                if (fwd) {
+                    for (int s = chunkStart[c]; s < chunkStart[c + 1]; s++) forward(s, &block[S.panelPtr[s] - base]);
+                } else {
+                    for (int s = chunkStart[c + 1] - 1; s >= chunkStart[c]; s--) backward(s, &block[S.panelPtr[s] - base]);
+                }
+            }
+        }
+    }
+
+    x.resize(n);
+    for (int k = 0; k < n; k++) x[S.perm[k]] = y[k];
+}
+
+
+// SparseCholesky Persistence - Versioned Factor Files
+// Layout: the header, A (to verify a hit), the supernodal structure, then
+// the panels at a 64-byte aligned offset. Every section starts on an 8-byte
+// boundary, so a mapped file is read in place with no parsing.
+
+static const char FACTOR_FILE_MAGIC[8] = {'C', 'I', 'R', 'C', 'F', 'A', 'C', 'T'};
+static const uint32_t FACTOR_FILE_VERSION = 1;
+static const uint32_t FACTOR_FILE_BYTE_ORDER = 0x01020304; // Reads back differently on the other endianness
+
+struct FactorFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint64_t key;          // matrixHash(A)
+    int64_t n, nnzA;
+    int64_t supernodes, rowEntries, factorEntries, maxStackEntries;
+    int64_t maxFront;
+    double flops;
+    uint64_t fileBytes;
+};
+
+// Byte offsets of every section, derived from the header's counts
+struct FactorFileLayout {
+    size_t colPtr, rowIdx, values, perm, snodeStart, snodeParent, rowPtr, snodeRows, panelPtr, panels, total;
+};
+
+static FactorFileLayout factorFileLayout(const FactorFileHeader& h) {
+    FactorFileLayout L;
+    size_t at = sizeof(FactorFileHeader);
+    auto section = [&at](size_t bytes, size_t align) {
+        at = (at + align - 1) / align * align;
+        size_t start = at;
+        at += bytes;
+        return start;
+    };
+    L.colPtr = section((h.n + 1) * sizeof(int), 8);
+    L.rowIdx = section(h.nnzA * sizeof(int), 8);
+    L.values = section(h.nnzA * sizeof(double), 8);
+    L.perm = section(h.n * sizeof(int), 8);
+    L.snodeStart = section((h.supernodes + 1) * sizeof(int), 8);
+    L.snodeParent = section(h.supernodes * sizeof(int), 8);
+    L.rowPtr = section((h.supernodes + 1) * sizeof(long long), 8);
+    L.snodeRows = section(h.rowEntries * sizeof(int), 8);
+    L.panelPtr = section((h.supernodes + 1) * sizeof(long long), 8);
+    L.panels = section(h.factorEntries * sizeof(double), 64);
+    L.total = at;
+    return L;
+}
+
+void SparseCholesky::saveFactor(const string& path, const SparseMatrix& A, unsigned long long key) const {
+    if (isOutOfCore()) throw runtime_error("Out-of-core factors cannot be saved.");
+    if ((long long)panels.size() != S.factorEntries && !isMapped()) throw runtime_error("No factor to save.");
+    TraceScope io("factor_save", "io");
+
+    FactorFileHeader h = {};
+    memcpy(h.magic, FACTOR_FILE_MAGIC, sizeof(h.magic));
+    h.version = FACTOR_FILE_VERSION;
+    h.byteOrder = FACTOR_FILE_BYTE_ORDER;
+    h.key = key;
+    h.n = A.n;
+    h.nnzA = A.nnz();
+    h.supernodes = S.supernodes();
+    h.rowEntries = (int64_t)S.rowIdx.size();
+    h.factorEntries = S.factorEntries;
+    h.maxStackEntries = S.maxStackEntries;
+    h.maxFront = S.maxFront;
+    h.flops = S.flops;
+    FactorFileLayout layout = factorFileLayout(h);
+    h.fileBytes = layout.total;
+
+    replaceFile(path, "factor file", [&](ostream& out) {
+        size_t at = 0;
+        auto put = [&](size_t offset, const void* data, size_t bytes) {
+            static const char zeros[64] = {};
+            out.write(zeros, offset - at); // Alignment padding
+            out.write(static_cast<const char*>(data), bytes);
+            at = offset + bytes;
+        };
+        put(0, &h, sizeof(h));
+        put(layout.colPtr, A.colPtr.data(), A.colPtr.size() * sizeof(int));
+        put(layout.rowIdx, A.rowIdx.data(), A.rowIdx.size() * sizeof(int));
+        put(layout.values, A.values.data(), A.values.size() * sizeof(double));
+        put(layout.perm, S.perm.data(), S.perm.size() * sizeof(int));
+        put(layout.snodeStart, S.snodeStart.data(), S.snodeStart.size() * sizeof(int));
+        put(layout.snodeParent, S.snodeParent.data(), S.snodeParent.size() * sizeof(int));
+        put(layout.rowPtr, S.rowPtr.data(), S.rowPtr.size() * sizeof(long long));
+        put(layout.snodeRows, S.rowIdx.data(), S.rowIdx.size() * sizeof(int));
+        put(layout.panelPtr, S.panelPtr.data(), S.panelPtr.size() * sizeof(long long));
+        put(layout.panels, factorData(), (size_t)S.factorEntries * sizeof(double));
+    });
+}
+
+// Helper: the whole file, memory-mapped read-only where the platform allows
+// (read into memory otherwise). Null if it cannot be opened.
+static shared_ptr<const void> mapWholeFile(const string& path, size_t& bytes) {
+#ifdef CIRCUIT_HAVE_MMAP
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return nullptr;
+    struct stat st;
+    void* data = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        bytes = (size_t)st.st_size;
+        data = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    close(fd); // The mapping keeps the file alive
+    if (data == MAP_FAILED) return nullptr;
+    size_t length = bytes;
+    return shared_ptr<const void>(data, [length](const void* p) { munmap(const_cast<void*>(p), length); });
+#else
+    ifstream in(path, ios::binary | ios::ate);
+    if (!in) return nullptr;
+    bytes = (size_t)in.tellg();
+    auto buffer = make_shared<vector<double>>((bytes + sizeof(double) - 1) / sizeof(double));
+    in.seekg(0);
+    in.read(reinterpret_cast<char*>(buffer->data()), bytes);
+    if (!in) return nullptr;
+    return shared_ptr<const void>(buffer, buffer->data());
+#endif
+}
+
+// Helper: whether a structure read from a factor file can be used without
+// any index leaving its array (the file's checks do not cover this part)
+static bool validStructure(const SupernodalStructure& S) {
+    int n = S.n, ns = S.supernodes();
+    vector<char> seen(n, 0);
+    for (int p : S.perm) {
+        if (p < 0 || p >= n || seen[p]) return false;
+        seen[p] = 1;
+    }
+    if (S.snodeStart[0] != 0 || S.snodeStart[ns] != n) return false;
+    if (S.rowPtr[0] != 0 || S.panelPtr[0] != 0) return false;
+    for (int s = 0; s < ns; s++) {
+        if (S.snodeStart[s + 1] <= S.snodeStart[s]) return false;
+        if (S.rowPtr[s + 1] < S.rowPtr[s] || S.panelPtr[s + 1] < S.panelPtr[s]) return false;
+    }
+    if (S.rowPtr[ns] != (long long)S.rowIdx.size()) return false;
+    for (int s = 0; s < ns; s++) {
+        if (S.snodeParent[s] != -1 && (S.snodeParent[s] <= s || S.snodeParent[s] >= ns)) return false;
+        long long m = S.rows(s), k = S.cols(s);
+        if (m < k || m > S.maxFront || S.panelPtr[s + 1] - S.panelPtr[s] != m * k) return false;
+        for (long long q = S.rowPtr[s]; q < S.rowPtr[s + 1]; q++) {
+            if (S.rowIdx[q] < 0 || S.rowIdx[q] >= n) return false;
+        }
+        for (int j = 0; j < k; j++) { // Own columns first
+            if (S.rowIdx[S.rowPtr[s] + j] != S.snodeStart[s] + j) return false;
+        }
+    }
+    return S.maxStackEntries >= 0;
+}
+
+bool SparseCholesky::mapFactor(const string& path, const SparseMatrix& A, unsigned long long key) {
+    TraceScope io("factor_map", "io");
+    size_t bytes = 0;
+    shared_ptr<const void> file = mapWholeFile(path, bytes);
+    if (!file || bytes < sizeof(FactorFileHeader)) return false;
+    const char* base = static_cast<const char*>(file.get());
+
+    FactorFileHeader h;
+    memcpy(&h, base, sizeof(h));
+    if (memcmp(h.magic, FACTOR_FILE_MAGIC, sizeof(h.magic)) != 0 || h.version != FACTOR_FILE_VERSION ||
+        h.byteOrder != FACTOR_FILE_BYTE_ORDER || h.fileBytes != bytes) {
+        return false;
+    }
+    if (h.n != A.n || h.nnzA != A.nnz() || h.key != key) return false;
+    if (h.supernodes < 0 || h.supernodes > h.n || h.rowEntries < 0 || h.factorEntries < 0) return false;
+    FactorFileLayout layout = factorFileLayout(h);
+    if (layout.total != bytes) return false;
+
+    // The hash only picks the file; the factor is used only for exactly A
+    if (memcmp(base + layout.colPtr, A.colPtr.data(), A.colPtr.size() * sizeof(int)) != 0 ||
+        memcmp(base + layout.rowIdx, A.rowIdx.data(), A.rowIdx.size() * sizeof(int)) != 0 ||
+        memcmp(base + layout.values, A.values.data(), A.values.size() * sizeof(double)) != 0) {
+        return false;
+    }
+
+    auto read = [base](auto& v, size_t offset, long long count) {
+        using T = typename remove_reference_t<decltype(v)>::value_type;
+        const T* p = reinterpret_cast<const T*>(base + offset);
+        v.assign(p, p + count);
+    };
+    SupernodalStructure structure;
+    structure.n = (int)h.n;
+    read(structure.perm, layout.perm, h.n);
+    read(structure.snodeStart, layout.snodeStart, h.supernodes + 1);
+    read(structure.snodeParent, layout.snodeParent, h.supernodes);
+    read(structure.rowPtr, layout.rowPtr, h.supernodes + 1);
+    read(structure.rowIdx, layout.snodeRows, h.rowEntries);
+    read(structure.panelPtr, layout.panelPtr, h.supernodes + 1);
+    structure.factorEntries = h.factorEntries;
+    structure.maxStackEntries = h.maxStackEntries;
+    structure.maxFront = (int)h.maxFront;
+    structure.flops = h.flops;
+    if (structure.panelPtr.back() != h.factorEntries || structure.rowPtr.back() != h.rowEntries) return false;
+    if (h.maxFront < 0 || h.maxFront > h.n || !validStructure(structure)) return false;
+
+    analyze(move(structure));
+    if (isOutOfCore()) remove(scratchPath.c_str());
+    scratchPath.clear();
+    vector<double>().swap(panels);
+    mapping = move(file);
+    mappedPanels = reinterpret_cast<const double*>(base + layout.panels);
+    return true;
+}
+
+
+// Helper: smallest eigenvalue of a symmetric tridiagonal matrix by Sturm
+// sequence bisection (diag[0..k), off[i] couples rows i and i+1)
+
+static double smallestEigenvalue(const vector<double>& diag, const vector<double>& off) {
+    int k = (int)diag.size();
+    double lo = diag[0], hi = diag[0];
+    for (int i = 0; i < k; i++) {
+        double radius = (i > 0 ? fabs(off[i - 1]) : 0.0) + (i + 1 < k ? fabs(off[i]) : 0.0);
+        lo = min(lo, diag[i] - radius);
+        hi = max(hi, diag[i] + radius);
+    }
+    // Number of eigenvalues below x = number of negative pivots of T - x I
+    auto countBelow = [&](double x) {
+        int count = 0;
+        double d = 1.0;
+        for (int i = 0; i < k; i++) {
+            double o = i > 0 ? off[i - 1] : 0.0;
+            d = diag[i] - x - (i > 0 ? o * o / d : 0.0);
+            if (d == 0.0) d = -1e-300;
+            if (d < 0) count++;
+        }
+        return count;
+    };
+    for (int step = 0; step < 100 && hi - lo > 1e-12 * max(fabs(lo), fabs(hi)); step++) {
+        double mid = 0.5 * (lo + hi);
+        if (countBelow(mid) >= 1) hi = mid;
+        else lo = mid;
+    }
+    return 0.5 * (lo + hi);
+}
+
+
+// pcgSolve() Implementation
+
+IterativeResult pcgSolve(const SparseMatrix& A, const vector<double>& b, double tolerance,
+                         int maxIterations, const vector<double>* x0, const IterationCallback& keepGoing,
+                         const Preconditioner& precondition) {
+    int n = A.n;
+    IterativeResult res;
+    res.x = x0 ? *x0 : vector<double>(n, 0.0);
+    if (maxIterations <= 0) maxIterations = max(1, 10 * n);
+
+    // Jacobi preconditioner: inverse of the diagonal
+    vector<double> invDiag(n, 0.0);
+    for (int j = 0; j < n; j++) {
+        for (int p = A.colPtr[j]; p < A.colPtr[j + 1]; p++) {
+            if (A.rowIdx[p] == j) invDiag[j] = A.values[p];
+        }
+        if (!(invDiag[j] > 0.0)) {
+            throw runtime_error(SINGULAR_MESSAGE);
+        }
+        invDiag[j] = 1.0 / invDiag[j];
+    }
+
+    auto multiply = [&](const vector<double>& v, vector<double>& out) {
+        fill(out.begin(), out.end(), 0.0);
+        for (int j = 0; j < n; j++) {
+            double vj = v[j];
+            for (int p = A.colPtr[j]; p < A.colPtr[j + 1]; p++) out[A.rowIdx[p]] += A.values[p] * vj;
+        }
+    };
+    auto dot = [](const vector<double>& a, const vector<double>& c) {
+        double sum = 0.0;
+        for (size_t i = 0; i < a.size(); i++) sum += a[i] * c[i];
+        return sum;
+    };
+
+    vector<double> r(n), z(n), p(n), q(n);
+    multiply(res.x, q);
+    for (int i = 0; i < n; i++) r[i] = b[i] - q[i];
+    double bnorm = sqrt(dot(b, b));
+    if (bnorm == 0.0) bnorm = 1.0;
+    double rnorm = sqrt(dot(r, r));
+
+    auto applyPreconditioner = [&]() {
+        if (precondition) precondition(r, z);
+        else for (int i = 0; i < n; i++) z[i] = invDiag[i] * r[i];
+    };
+    applyPreconditioner();
+    p = z;
+    double rz = dot(r, z);
+
+    // Lanczos tridiagonal T built from the CG coefficients; its eigenvalues
+    // approximate those of the Jacobi-preconditioned matrix
+    vector<double> lanczosDiag, lanczosOff;
+    double prevAlpha = 0.0, prevBeta = 0.0;
+    while (rnorm > tolerance * bnorm && res.iterations < maxIterations) {
+        multiply(p, q);
+        double alpha = rz / dot(p, q);
+        for (int i = 0; i < n; i++) { res.x[i] += alpha * p[i]; r[i] -= alpha * q[i]; }
+        rnorm = sqrt(dot(r, r));
+        res.iterations++;
+        applyPreconditioner();
+        double rzNew = dot(r, z);
+        double beta = rzNew / rz;
+        rz = rzNew;
+        for (int i = 0; i < n; i++) p[i] = z[i] + beta * p[i];
+
+        if (lanczosDiag.empty()) {
+            lanczosDiag.push_back(1.0 / alpha);
+        } else {
+            lanczosDiag.push_back(1.0 / alpha + prevBeta / prevAlpha);
+            lanczosOff.push_back(sqrt(prevBeta) / prevAlpha);
+        }
+        prevAlpha = alpha;
+        prevBeta = beta;
+
+        if (keepGoing && !keepGoing(res.iterations, rnorm / bnorm)) break;
+    }
+    res.relativeResidual = rnorm / bnorm;
+    res.converged = rnorm <= tolerance * bnorm;
+
+    // ||e||_D <= ||r||_{D^-1} / lambda_min(D^-1 A), and ||e||_2 <= ||e||_D / sqrt(min D)
+    if (!precondition && !lanczosDiag.empty() && rz > 0.0) {
+        double lambdaMin = smallestEigenvalue(lanczosDiag, lanczosOff);
+        double maxInvDiag = *max_element(invDiag.begin(), invDiag.end());
+        if (lambdaMin > 0.0) res.errorEstimate = sqrt(rz) / lambdaMin * sqrt(maxInvDiag);
+    }
+    return res;
+}
+
+
+// coarsen() Implementation
+
+CoarseLevel coarsen(const SparseMatrix& A) {
+    int n = A.n;
+    CoarseLevel level;
+    level.aggregate.assign(n, -1);
+    int coarseN = 0;
+
+    // Pass 1: seed an aggregate at every node whose whole neighbourhood is free
+    for (int i = 0; i < n; i++) {
+        if (level.aggregate[i] >= 0) continue;
+        bool allFree = true;
+        for (int p = A.colPtr[i]; p < A.colPtr[i + 1] && allFree; p++) {
+            if (level.aggregate[A.rowIdx[p]] >= 0) allFree = false;
+        }
+        if (!allFree) continue;
+        for (int p = A.colPtr[i]; p < A.colPtr[i + 1]; p++) level.aggregate[A.rowIdx[p]] = coarseN;
+        level.aggregate[i] = coarseN++;
+    }
+
+    // Pass 2: attach the rest to the aggregate they are most strongly coupled
+    // to (decided from the pass 1 result so the order does not matter)
+    vector<int> seeded = level.aggregate;
+    for (int i = 0; i < n; i++) {
+        if (seeded[i] >= 0) continue;
+        double strongest = 0.0;
+        for (int p = A.colPtr[i]; p < A.colPtr[i + 1]; p++) {
+            int j = A.rowIdx[p];
+            if (j != i && seeded[j] >= 0 && fabs(A.values[p]) > strongest) {
+                strongest = fabs(A.values[p]);
+                level.aggregate[i] = seeded[j];
+            }
+        }
+        if (level.aggregate[i] < 0) level.aggregate[i] = coarseN++; // Isolated
+    }
+
+    // Galerkin product: entry (i, j) of A lands on (agg[i], agg[j])
+    vector<int> rows, cols;
+    vector<double> vals;
+    rows.reserve(A.nnz()); cols.reserve(A.nnz()); vals.reserve(A.nnz());
+    for (int j = 0; j < n; j++) {
+        for (int p = A.colPtr[j]; p < A.colPtr[j + 1]; p++) {
+            rows.push_back(level.aggregate[A.rowIdx[p]]);
+            cols.push_back(level.aggregate[j]);
+            vals.push_back(A.values[p]);
+        }
+    }
+    level.A = buildFromTriplets(coarseN, rows, cols, vals);
+    return level;
+}
+
+
+// restrictToCoarse() Implementation
+
+vector<double> restrictToCoarse(const CoarseLevel& level, const vector<double>& fine) {
+    vector<double> coarse(level.A.n, 0.0);
+    for (size_t i = 0; i < fine.size(); i++) coarse[level.aggregate[i]] += fine[i];
+    return coarse;
+}
+
+
+// CoarseHierarchy Implementation
+
+void CoarseHierarchy::analyze(const SparseMatrix& A, int targetUnknowns) {
+    fineA = &A;
+    levels.clear();
+    invDiag.clear();
+    // Stop early if aggregation no longer shrinks the graph (e.g. a circuit
+    // made of isolated resistors to ground)
+    while (op(depth()).n > targetUnknowns) {
+        CoarseLevel level = coarsen(op(depth()));
+        if (level.A.n > op(depth()).n * 4 / 5) break;
+        levels.push_back(move(level));
+    }
+
+    for (int l = 0; l < depth(); l++) {
+        const SparseMatrix& M = op(l);
+        vector<double> inv(M.n, 0.0);
+        for (int j = 0; j < M.n; j++) {
+            for (int p = M.colPtr[j]; p < M.colPtr[j + 1]; p++) {
+                if (M.rowIdx[p] == j && M.values[p] > 0.0) inv[j] = 1.0 / M.values[p];
+            }
+        }
+        invDiag.push_back(move(inv));
+    }
+
+    const SparseMatrix& C = op(depth());
+    coarsest.analyze(C, symbolicAnalysis(C, minimumDegreeOrdering(C)));
+}
+
+double CoarseHierarchy::levelBytes() const {
+    double bytes = 0;
+    for (const CoarseLevel& level : levels) {
+        bytes += level.A.nnz() * (sizeof(int) + sizeof(double)) + (level.A.n + 1) * sizeof(int);
+        bytes += level.aggregate.size() * sizeof(int);
+    }
+    for (const vector<double>& inv : invDiag) bytes += inv.size() * sizeof(double);
+    return bytes;
+}
+
+// Helper: damped Jacobi sweeps x += w D^-1 (b - A x) on level l
+
+void CoarseHierarchy::smooth(int l, const vector<double>& b, vector<double>& x, int sweeps) const {
+    const SparseMatrix& M = op(l);
+    const double omega = 2.0 / 3.0;
+    vector<double> ax(M.n);
+    for (int sweep = 0; sweep < sweeps; sweep++) {
+        fill(ax.begin(), ax.end(), 0.0);
+        for (int j = 0; j < M.n; j++) {
+            for (int p = M.colPtr[j]; p < M.colPtr[j + 1]; p++) ax[M.rowIdx[p]] += M.values[p] * x[j];
+        }
+        for (int i = 0; i < M.n; i++) x[i] += omega * invDiag[l][i] * (b[i] - ax[i]);
+    }
+}
+
+// Helper: copy each coarse value of level l + 1 to its aggregate on level l
+
+vector<double> CoarseHierarchy::prolongate(int l, const vector<double>& coarseX) const {
+    const vector<int>& aggregate = levels[l].aggregate;
+    vector<double> x(aggregate.size());
+    for (size_t i = 0; i < aggregate.size(); i++) x[i] = coarseX[aggregate[i]];
+    return x;
+}
+
+vector<double> CoarseHierarchy::solve(const vector<double>& b) const {
+    vector<vector<double>> rhs = {b};
+    for (int l = 0; l < depth(); l++) rhs.push_back(restrictToCoarse(levels[l], rhs.back()));
+    vector<double> x = coarsest.solve(rhs.back());
+    for (int l = depth() - 1; l >= 0; l--) {
+        x = prolongate(l, x);
+        smooth(l, rhs[l], x, 2);
+    }
+    return x;
+}
+
+// Helper: V-cycle from a zero guess with the same number of pre- and
+// post-smoothing sweeps, which keeps the preconditioner symmetric
+
+vector<double> CoarseHierarchy::vcycle(int l, const vector<double>& b) const {
+    if (l == depth()) return coarsest.solve(b);
+    const SparseMatrix& M = op(l);
+    vector<double> x(M.n, 0.0);
+    smooth(l, b, x, 1);
+
+    vector<double> r = b;
+    for (int j = 0; j < M.n; j++) {
+        for (int p = M.colPtr[j]; p < M.colPtr[j + 1]; p++) r[M.rowIdx[p]] -= M.values[p] * x[j];
+    }
+    vector<double> correction = prolongate(l, vcycle(l + 1, restrictToCoarse(levels[l], r)));
+    for (int i = 0; i < M.n; i++) x[i] += correction[i];
+
+    smooth(l, b, x, 1);
+    return x;
+}
@@ -0,0 +1,332 @@
+#ifndef SPARSE_SOLVER_H
+#define SPARSE_SOLVER_H
+
+#include <vector>
+#include <string>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include "CircuitSolver.h"
+
+using namespace std;
+
+// Same wording as the dense solver so callers see one message for both paths
+extern const char* const SINGULAR_MESSAGE;
+
+
+// 1. Sparse Matrix Storage (Compressed Sparse Column)
+
+
+// Symmetric matrices keep BOTH triangles so the graph algorithms below can
+// walk a node's neighbours directly. Row indices are sorted in each column.
+struct SparseMatrix {
+    int n = 0;
+    vector<int> colPtr;    // Size n + 1, start of each column in rowIdx/values
+    vector<int> rowIdx;    // Row index of every stored entry
+    vector<double> values; // Value of every stored entry
+
+    long long nnz() const { return colPtr.empty() ? 0 : colPtr[n]; }
+};
+
+// Helper: Build a CSC matrix from (row, col, value) triplets, summing duplicates
+SparseMatrix buildFromTriplets(int n, const vector<int>& rows, const vector<int>& cols,
+                               const vector<double>& vals);
+
+// Helper: 64-bit hash of the pattern and the exact values (bit patterns)
+unsigned long long matrixHash(const SparseMatrix& A);
+
+// Helper: replace the file at path whole. write() fills a temporary file
+// in the same directory, named uniquely per process and per call, which
+// is then renamed over path, so a concurrent reader (in any process) sees
+// either the old file or the complete new one. Throws runtime_error naming
+// `what` if the file cannot be written or moved into place.
+void replaceFile(const string& path, const string& what, const function<void(ostream&)>& write);
+
+
+// 2. Reduced Nodal System (Symmetric Positive Definite)
+
+
+// Full MNA adds one row per voltage source and is indefinite, which rules out
+// Cholesky and CG. Instead every tree of voltage sources is collapsed into a
+// single "supernode": its nodes share one unknown plus a fixed offset, and a
+// tree that touches ground has no unknown at all. What is left is the
+// conductance matrix of the supernodes, which is SPD whenever every node has
+// a resistive path to ground (exactly when the MNA matrix is non-singular).
+struct NodalSystem {
+    int unknowns = 0;
+    vector<int> nodeToUnknown; // Per node ID: unknown index, or -1 when fixed
+    vector<double> nodeOffset; // V(node) = x[nodeToUnknown] + nodeOffset
+    SparseMatrix A;            // Conductance matrix on the unknowns
+    vector<double> b;          // Injected currents (sources and fixed nodes)
+    int floatingGroups = 0;    // Groups with no resistive path to ground (A singular)
+
+    // Map a solution of A x = b back to voltages indexed by node ID
+    vector<double> expand(const vector<double>& x) const;
+};
+
+// Throws runtime_error if the voltage sources form a loop
+NodalSystem buildNodalSystem(const Circuit& circuit);
+
+
+// 3. Fill-Reducing Orderings
+
+
+// An ordering is a permutation: perm[k] = index of the unknown eliminated k-th
+vector<int> naturalOrdering(const SparseMatrix& A);
+vector<int> rcmOrdering(const SparseMatrix& A);            // Reverse Cuthill-McKee
+vector<int> minimumDegreeOrdering(const SparseMatrix& A);  // Greedy minimum degree
+
+// Helper: inverse permutation (pinv[perm[k]] = k)
+vector<int> invertPermutation(const vector<int>& perm);
+
+// Helper: longest BFS eccentricity found from pseudo-peripheral nodes, over
+// all connected components (a cheap lower bound on the graph diameter)
+int pseudoDiameter(const SparseMatrix& A);
+
+
+// 4. Symbolic Analysis (no numeric factorization)
+
+
+// Structure of the Cholesky factor L of P A P^T, computed from the
+// elimination tree in O(nnz(L)) time without touching any values.
+struct SymbolicFactor {
+    vector<int> perm;       // Ordering used
+    vector<int> parent;     // Elimination tree (-1 = root), permuted indices
+    vector<int> colCount;   // Entries per column of L, diagonal included
+    long long nnzL = 0;     // Total entries in L
+    double flops = 0;       // Factorization flops (sum of colCount^2)
+    int bandwidth = 0;      // max |i - j| over entries of P A P^T
+    int maxColCount = 0;    // Largest column of L (dense front size)
+};
+
+SymbolicFactor symbolicAnalysis(const SparseMatrix& A, const vector<int>& perm);
+
+// Helper: half-bandwidth of A when reordered by perm
+int bandwidthUnder(const SparseMatrix& A, const vector<int>& perm);
+
+
+// 5. Supernodal Multifrontal Cholesky (Sparse Direct)
+
+
+// Consecutive columns of L with the same pattern below the diagonal form a
+// supernode, stored as one dense column-major panel (rows x columns). The
+// columns are renumbered in elimination-tree postorder so every supernode is
+// a contiguous range and children always come before their parents.
+struct SupernodalStructure {
+    int n = 0;
+    vector<int> perm;            // Final ordering (fill-reducing + postorder)
+    vector<int> snodeStart;      // Supernode s owns columns [snodeStart[s], snodeStart[s+1])
+    vector<int> snodeParent;     // Supernodal elimination tree (-1 = root)
+    vector<long long> rowPtr;    // Row list of s: rowIdx[rowPtr[s] .. rowPtr[s+1])
+    vector<int> rowIdx;          // Own columns first, then the update rows, ascending
+    vector<long long> panelPtr;  // Offset of each panel in the factor array
+    long long factorEntries = 0; // Doubles needed for all panels
+    long long maxStackEntries = 0; // Peak size of the update-matrix stack
+    int maxFront = 0;            // Largest frontal matrix dimension
+    double flops = 0;
+
+    int supernodes() const { return (int)snodeStart.size() - 1; }
+    int rows(int s) const { return (int)(rowPtr[s + 1] - rowPtr[s]); }
+    int cols(int s) const { return snodeStart[s + 1] - snodeStart[s]; }
+};
+
+// Build the supernodal structure from an ordering's symbolic analysis
+SupernodalStructure analyzeSupernodal(const SparseMatrix& A, const SymbolicFactor& sym);
+
+// Disjoint subtrees of the supernodal elimination tree, packed into about
+// four tasks per thread of similar flops. Tasks share no data, so they can
+// be factorized in parallel; the rest of the tree (the top separators) is
+// factorized afterwards on the calling thread.
+struct SubtreePartition {
+    vector<int> owner;                           // Per supernode: task index, -1 = top part
+    vector<vector<pair<int, int>>> taskRanges;   // [first, root] of each subtree of a task
+    vector<int> taskFront;                       // Largest front of each task
+    vector<long long> taskStack;                 // Peak update stack of each task
+    long long workspaceEntries = 0;              // Doubles of all task workspaces
+
+    int tasks() const { return (int)taskRanges.size(); }
+};
+
+// Empty (no tasks) when width < 2 or the tree does not split into two tasks
+SubtreePartition partitionSubtrees(const SupernodalStructure& S, int width);
+
+class SparseCholesky {
+private:
+    SupernodalStructure S;
+    vector<double> panels; // All factor panels, see SupernodalStructure::panelPtr
+
+    // Out-of-core mode: finished panels are streamed to a scratch file in
+    // large sequential blocks instead of being kept in 'panels'
+    string scratchPath;
+    size_t ioBlockBytes = 0;
+    vector<int> chunkStart; // Supernodes grouped into read blocks for solve()
+
+    // Mapped mode: the panels live in a factor file (see mapFactor()), kept
+    // mapped for as long as 'mapping' is held
+    shared_ptr<const void> mapping;
+    const double* mappedPanels = nullptr;
+    const double* factorData() const { return mappedPanels ? mappedPanels : panels.data(); }
+    void unmap() { mapping.reset(); mappedPanels = nullptr; }
+
+    // Frontal matrix, update-matrix stack and row map of one thread of work
+    struct FrontWorkspace {
+        vector<int> relPos;
+        vector<double> front, updates, diagA;
+        long long top = 0; // Used part of 'updates'
+    };
+
+    // Factorization workspace, kept so that refactorizing with the same
+    // structure (new values, same pattern) allocates nothing
+    bool workspaceReady = false;
+    vector<int> pinv, childHead, childNext;
+    FrontWorkspace mainWork;
+
+    // Parallel mode: each task of the partition has its own workspace; a
+    // task's subtree roots leave their update matrices in its stack, at
+    // rootUpdate[root], for the top part to pick up
+    ParallelFor parallel;
+    int parallelWidth = 1;
+    SubtreePartition partition;
+    vector<FrontWorkspace> taskWork;
+    vector<long long> rootUpdate;
+
+    void prepareWorkspace();
+    int ownerOf(int s) const { return partition.owner.empty() ? -1 : partition.owner[s]; }
+    void factorSupernode(const SparseMatrix& A, int s, FrontWorkspace& w);
+
+public:
+    SparseCholesky() = default;
+    SparseCholesky(const SparseCholesky&) = delete; // Owns the scratch file
+    SparseCholesky& operator=(const SparseCholesky&) = delete;
+    ~SparseCholesky();
+
+    void analyze(const SparseMatrix& A, const SymbolicFactor& sym) { S = analyzeSupernodal(A, sym); workspaceReady = false; unmap(); }
+    void analyze(SupernodalStructure structure) { S = move(structure); workspaceReady = false; unmap(); }
+
+    // Spill the factor to 'path' (created, and removed with this object).
+    // At most two blocks of 'blockBytes' are held in memory at a time.
+    void setOutOfCore(const string& path, size_t blockBytes = DEFAULT_IO_BLOCK_BYTES);
+    bool isOutOfCore() const { return !scratchPath.empty(); }
+
+    // Factorize independent subtrees through 'runner' (see ParallelFor),
+    // sized for 'width' threads. In-core only; the factor is bitwise the
+    // same as the serial one. An empty runner turns it off.
+    void setParallel(ParallelFor runner, int width);
+
+    // Numeric factorization; throws runtime_error if A is not positive
+    // definite. keepGoing is called after every supernode (see
+    // FactorizationCallback), at no cost when empty.
+    void factorize(const SparseMatrix& A, const FactorizationCallback& keepGoing = nullptr);
+
+    // Forward and backward substitution with the stored factor
+    vector<double> solve(const vector<double>& b) const;
+
+    // Same, into caller-owned x and work (resized to n). In-core factors
+    // allocate nothing once both vectors have the right size.
+    void solve(const vector<double>& b, vector<double>& x, vector<double>& work) const;
+
+    const SupernodalStructure& structure() const { return S; }
+
+    // Persistent factors. saveFactor() writes the structure and the in-core
+    // panels of A's factorization to a versioned binary file (written
+    // aside and renamed into place, so readers never see half a file).
+    // mapFactor() memory-maps such a file in place of analyze() and
+    // factorize(), after checking that it was made from exactly A and that
+    // its structure is consistent; false (and nothing changes) for a
+    // missing, foreign, truncated or corrupt file. `key` is matrixHash(A).
+    void saveFactor(const string& path, const SparseMatrix& A, unsigned long long key) const;
+    bool mapFactor(const string& path, const SparseMatrix& A, unsigned long long key);
+    bool isMapped() const { return mappedPanels != nullptr; }
+
+    static const size_t DEFAULT_IO_BLOCK_BYTES = 64u << 20;
+};
+
+
+// 6. Preconditioned Conjugate Gradient (Iterative)
+
+
+struct IterativeResult {
+    vector<double> x;
+    int iterations = 0;
+    double relativeResidual = 0; // ||b - A x|| / ||b||
+    double errorEstimate = 0;    // Estimated ||x - x_exact||_2 (see pcgSolve)
+    bool converged = false;
+};
+
+// Called after every iteration with (iteration, relative residual); return
+// false to stop early, e.g. when a deadline has passed
+typedef function<bool(int, double)> IterationCallback;
+
+// Applies z = M^-1 r for a symmetric positive definite preconditioner M
+typedef function<void(const vector<double>&, vector<double>&)> Preconditioner;
+
+// Preconditioned CG, Jacobi unless 'precondition' is given. maxIterations
+// <= 0 means 10 * n; x0 is an optional starting guess. With Jacobi the error
+// estimate divides the preconditioned residual by the smallest Ritz value of
+// the CG Lanczos matrix, so it is only reliable once a few dozen iterations
+// have run; with a custom preconditioner it is left at 0.
+IterativeResult pcgSolve(const SparseMatrix& A, const vector<double>& b, double tolerance = 1e-10,
+                         int maxIterations = 0, const vector<double>* x0 = nullptr,
+                         const IterationCallback& keepGoing = nullptr,
+                         const Preconditioner& precondition = nullptr);
+
+
+// 7. Coarse-to-Fine Hierarchy (Node Aggregation)
+
+
+// Neighbouring unknowns are grouped into aggregates that act as one coarse
+// unknown. The coarse matrix is P^T A P for the piecewise-constant
+// prolongation P, so it stays SPD and keeps every resistive path to ground.
+struct CoarseLevel {
+    SparseMatrix A;        // Coarse conductance matrix
+    vector<int> aggregate; // Fine unknown -> coarse unknown
+};
+
+// One level of greedy aggregation: a node whose neighbours are all free
+// seeds an aggregate with them, leftover nodes join their strongest
+// aggregated neighbour
+CoarseLevel coarsen(const SparseMatrix& A);
+
+// Sum a fine vector over each aggregate
+vector<double> restrictToCoarse(const CoarseLevel& level, const vector<double>& fine);
+
+// The aggregation levels of a system down to one small enough to factor.
+// Serves both as a quick approximate solver (the progressive preview) and
+// as a V-cycle preconditioner for pcgSolve, which keeps the refinement
+// after a preview faster than a cold Jacobi-preconditioned solve.
+class CoarseHierarchy {
+private:
+    const SparseMatrix* fineA = nullptr; // Not owned, must outlive the hierarchy
+    vector<CoarseLevel> levels;          // levels[l] coarsens operator(l)
+    vector<vector<double>> invDiag;      // Jacobi smoother per non-coarsest level
+    SparseCholesky coarsest;
+
+    const SparseMatrix& op(int l) const { return l == 0 ? *fineA : levels[l - 1].A; }
+    void smooth(int l, const vector<double>& b, vector<double>& x, int sweeps) const;
+    vector<double> prolongate(int l, const vector<double>& coarseX) const;
+    vector<double> vcycle(int l, const vector<double>& b) const;
+
+public:
+    // Coarsen until at most targetUnknowns remain (or aggregation stalls)
+    // and factor that level; exact when A already fits
+    void build(const SparseMatrix& A, int targetUnknowns) { analyze(A, targetUnknowns); factorize(); }
+
+    // build() in two steps, so the coarsest factor can be sized from
+    // coarseStructure() before it is allocated
+    void analyze(const SparseMatrix& A, int targetUnknowns);
+    void factorize() { coarsest.factorize(op(depth())); }
+    const SparseMatrix& coarseMatrix() const { return op(depth()); }
+    const SupernodalStructure& coarseStructure() const { return coarsest.structure(); }
+    double levelBytes() const; // Coarse matrices, aggregate maps and smoother diagonals
+
+    int coarseUnknowns() const { return coarsest.structure().n; }
+    int depth() const { return (int)levels.size(); }
+
+    // Solve the coarsest level and prolongate back up with smoothing
+    vector<double> solve(const vector<double>& b) const;
+
+    // One symmetric V-cycle (z ~ A^-1 r), usable as a CG preconditioner
+    void precondition(const vector<double>& r, vector<double>& z) const { z = vcycle(0, r); }
+};
+
+#endif // SPARSE_SOLVER_H
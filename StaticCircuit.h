@@ -0,0 +1,188 @@
+#ifndef STATIC_CIRCUIT_H
+#define STATIC_CIRCUIT_H
+
+#include <array>
+#include <string>
+#include <string_view>
+#include <stdexcept>
+#include "CircuitSolver.h"
+
+using namespace std;
+
+
+// 1. Compile-time Circuit Description
+
+
+// One component of a StaticCircuit; node IDs as Circuit assigns them
+struct StaticComponent {
+    ComponentType type = RESISTOR;
+    string_view name;
+    int nodeA = 0;
+    int nodeB = 0;
+    double value = 0;
+};
+
+// A circuit of at most MaxNodes non-ground nodes and MaxComponents
+// components that can be built and solved in a constant expression, for
+// fixed reference networks whose voltages should cost nothing at run time:
+//
+//     constexpr auto divider = StaticCircuit<2, 3>()
+//         .addVoltageSource("V1", "in", "GND", 5.0)
+//         .addResistor("R1", "in", "out", 1000.0)
+//         .addResistor("R2", "out", "GND", 1000.0);
+//     constexpr auto volts = divider.solve();             // array<double, 3>
+//     static_assert(volts[divider.getNodeID("out")] == 2.5);
+//
+// Nodes get IDs in order of first use and "GND", "gnd" and "0" are ground,
+// as in Circuit::loadCircuit(), so the voltages are indexed like
+// Circuit::solve()'s. Names are string_views, so they must outlive the
+// circuit (string literals do). The same checks as Circuit throw
+// invalid_argument, which in a constant expression is a compile error.
+template<size_t MaxNodes, size_t MaxComponents>
+class StaticCircuit {
+private:
+    array<string_view, MaxNodes + 1> nodeNames{}; // By node ID; [0] unused (ground)
+    array<StaticComponent, MaxComponents> components{};
+    size_t nodeCount = 0;
+    size_t componentCount = 0;
+    size_t voltageSourceCount = 0;
+
+    static constexpr bool isGround(string_view name) { return name == "GND" || name == "gnd" || name == "0"; }
+
+    // Helper: ID of an existing node (ground is 0), -1 if there is none
+    constexpr int findNode(string_view name) const {
+        if (isGround(name)) return 0;
+        for (size_t i = 1; i <= nodeCount; i++) {
+            if (nodeNames[i] == name) return (int)i;
+        }
+        return -1;
+    }
+
+    // Helper: get or create a node ID, like Circuit::getNodeID()
+    constexpr int nodeID(string_view name) {
+        int id = findNode(name);
+        if (id >= 0) return id;
+        nodeNames[++nodeCount] = name;
+        return (int)nodeCount;
+    }
+
+    // Helper: every check a new component must pass, made before any of its
+    // nodes is created, so a rejected component leaves the circuit unchanged
+    constexpr void checkComponent(string_view n1, string_view n2, const char* sameNodeError) const {
+        if (n1.empty() || n2.empty()) throw invalid_argument("Error: Node name cannot be empty.");
+        if (n1 == n2 || (isGround(n1) && isGround(n2))) throw invalid_argument(sameNodeError);
+        if (componentCount == MaxComponents) {
+            throw invalid_argument("Error: StaticCircuit has more components than MaxComponents.");
+        }
+        size_t newNodes = (findNode(n1) < 0 ? 1 : 0) + (findNode(n2) < 0 ? 1 : 0);
+        if (nodeCount + newNodes > MaxNodes) throw invalid_argument("Error: StaticCircuit has more nodes than MaxNodes.");
+    }
+
+    constexpr StaticCircuit& add(ComponentType type, string_view name, string_view n1, string_view n2, double value) {
+        StaticComponent& c = components[componentCount];
+        c.type = type;
+        c.name = name;
+        c.nodeA = nodeID(n1);
+        c.nodeB = nodeID(n2);
+        c.value = value;
+        componentCount++;
+        if (type == VOLTAGE_SOURCE) voltageSourceCount++;
+        return *this;
+    }
+
+public:
+    // Matrix size of the padded MNA system solve() eliminates
+    static constexpr size_t MATRIX_SIZE = MaxNodes + MaxComponents;
+
+    // --- Feature: Building (same rules as Circuit) ---
+    // Each returns *this, so a whole netlist is one expression.
+
+    constexpr StaticCircuit& addResistor(string_view name, string_view n1, string_view n2, double resistance) {
+        if (resistance <= 0) throw invalid_argument("Error: Resistance must be positive.");
+        checkComponent(n1, n2, "Error: Resistor cannot be connected to the same node.");
+        return add(RESISTOR, name, n1, n2, resistance);
+    }
+
+    constexpr StaticCircuit& addCurrentSource(string_view name, string_view nFrom, string_view nTo, double current) {
+        checkComponent(nFrom, nTo, "Error: Current Source cannot be connected to the same node.");
+        return add(CURRENT_SOURCE, name, nFrom, nTo, current);
+    }
+
+    constexpr StaticCircuit& addVoltageSource(string_view name, string_view nPos, string_view nNeg, double voltage) {
+        checkComponent(nPos, nNeg, "Error: Voltage Source cannot be connected to the same node.");
+        return add(VOLTAGE_SOURCE, name, nPos, nNeg, voltage);
+    }
+
+    // --- Feature: Lookups ---
+
+    constexpr size_t getNodeCount() const { return nodeCount; }
+    constexpr size_t getComponentCount() const { return componentCount; }
+    constexpr const StaticComponent& getComponent(size_t index) const { return components.at(index); }
+
+    // Throws invalid_argument for a node the circuit does not have
+    constexpr int getNodeID(string_view name) const {
+        int id = findNode(name);
+        if (id < 0) throw invalid_argument("Error: Node not found.");
+        return id;
+    }
+
+    // --- Feature: Solving ---
+
+    // Node voltages by node ID (index 0 = ground); IDs past getNodeCount()
+    // are 0. Stamps the same MNA system as stampMNA() (node rows, then one
+    // row per voltage source) into the top-left of a MATRIX_SIZE system
+    // whose remaining rows are the identity, and solves it with
+    // fixedGaussianElimination(). The padding rows never become pivots or
+    // get updated, so the voltages compare equal to the dense backend's.
+    // Throws runtime_error(SINGULAR_MESSAGE) for a singular circuit.
+    constexpr array<double, MaxNodes + 1> solve() const {
+        array<array<double, MATRIX_SIZE>, MATRIX_SIZE> A{};
+        array<double, MATRIX_SIZE> B{};
+        size_t vSourceIndex = 0;
+        for (size_t c = 0; c < componentCount; c++) {
+            const StaticComponent& comp = components[c];
+            if (comp.type == RESISTOR) {
+                double g = 1.0 / comp.value;
+                int u = comp.nodeA, v = comp.nodeB;
+                if (u!=0) { A[u-1][u-1]+=g; if(v!=0) A[u-1][v-1]-=g; }
+                if (v!=0) { A[v-1][v-1]+=g; if(u!=0) A[v-1][u-1]-=g; }
+            }
+            else if (comp.type == CURRENT_SOURCE) {
+                int u = comp.nodeA, v = comp.nodeB;
+                if (u!=0) B[u-1] -= comp.value;
+                if (v!=0) B[v-1] += comp.value;
+            }
+            else if (comp.type == VOLTAGE_SOURCE) {
+                size_t rIdx = nodeCount + vSourceIndex;
+                int p = comp.nodeA, n = comp.nodeB;
+                if (p!=0) { A[p-1][rIdx] = 1; A[rIdx][p-1] = 1; }
+                if (n!=0) { A[n-1][rIdx] = -1; A[rIdx][n-1] = -1; }
+                B[rIdx] = comp.value;
+                vSourceIndex++;
+            }
+        }
+        for (size_t i = nodeCount + voltageSourceCount; i < MATRIX_SIZE; i++) A[i][i] = 1;
+
+        array<double, MATRIX_SIZE> x = fixedGaussianElimination<MATRIX_SIZE>(A, B);
+        array<double, MaxNodes + 1> voltages{};
+        for (size_t i = 0; i < nodeCount; i++) voltages[i + 1] = x[i];
+        return voltages;
+    }
+
+    // The same circuit as a run-time Circuit (appended to `circuit`), so the
+    // compile-time voltages can be checked against Circuit::solve()
+    void addTo(Circuit& circuit) const {
+        for (size_t c = 0; c < componentCount; c++) {
+            const StaticComponent& comp = components[c];
+            string name(comp.name), a(nodeName(comp.nodeA)), b(nodeName(comp.nodeB));
+            if (comp.type == RESISTOR) circuit.addResistor(name, a, b, comp.value);
+            else if (comp.type == CURRENT_SOURCE) circuit.addCurrentSource(name, a, b, comp.value);
+            else circuit.addVoltageSource(name, a, b, comp.value);
+        }
+    }
+
+    // "GND" for ID 0
+    constexpr string_view nodeName(int id) const { return id == 0 ? string_view("GND") : nodeNames.at(id); }
+};
+
+#endif // STATIC_CIRCUIT_H
@@ -0,0 +1,159 @@
+#include "TraceRecorder.h"
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <iomanip>
+
+atomic<bool> traceSessionActive{false};
+
+
+// Helper: Session State
+
+struct TraceRecord {
+    long long timestampNs; // Since the session started
+    long long arg;
+    const char* name;
+    const char* category;
+    char type;
+};
+
+// Written only by its own thread; head is published with release so an
+// exporter that acquires it sees every record before it
+struct ThreadTraceBuffer {
+    int tid = 0;
+    unsigned session = 0;
+    string threadName;
+    vector<TraceRecord> ring;
+    atomic<unsigned long long> head{0};
+};
+
+struct TraceSession {
+    mutex lock; // Registration and export only, never taken per event
+    atomic<unsigned> id{0};
+    size_t capacity = DEFAULT_TRACE_EVENTS_PER_THREAD;
+    chrono::steady_clock::time_point epoch;
+    vector<shared_ptr<ThreadTraceBuffer>> buffers; // Outlive their threads
+};
+
+static TraceSession& session() {
+    static TraceSession s;
+    return s;
+}
+
+static thread_local shared_ptr<ThreadTraceBuffer> localBuffer;
+static thread_local string localThreadName;
+
+static ThreadTraceBuffer& threadBuffer() {
+    TraceSession& s = session();
+    if (localBuffer && localBuffer->session == s.id) return *localBuffer;
+    lock_guard<mutex> guard(s.lock);
+    auto buffer = make_shared<ThreadTraceBuffer>();
+    buffer->session = s.id;
+    buffer->tid = (int)s.buffers.size() + 1;
+    buffer->threadName = localThreadName.empty() ? "thread " + to_string(buffer->tid) : localThreadName;
+    buffer->ring.resize(s.capacity);
+    s.buffers.push_back(buffer);
+    localBuffer = buffer;
+    return *buffer;
+}
+
+static void writeJsonString(ostream& out, const string& text) {
+    out << '"';
+    for (char c : text) {
+        if (c == '"' || c == '\\') out << '\\';
+        out << c;
+    }
+    out << '"';
+}
+
+
+// Session Control
+
+void startTracing(size_t eventsPerThread) {
+    TraceSession& s = session();
+    traceSessionActive.store(false);
+    {
+        lock_guard<mutex> guard(s.lock);
+        size_t capacity = 1;
+        while (capacity < max<size_t>(eventsPerThread, 2)) capacity <<= 1;
+        s.id.fetch_add(1);
+        s.capacity = capacity;
+        s.buffers.clear();
+        s.epoch = chrono::steady_clock::now();
+    }
+    traceSessionActive.store(true);
+}
+
+void stopTracing() {
+    traceSessionActive.store(false);
+}
+
+
+// Recording
+
+void traceEvent(char type, const char* name, const char* category, long long arg) {
+    if (!tracingActive()) return;
+    ThreadTraceBuffer& buffer = threadBuffer();
+    long long now = chrono::duration_cast<chrono::nanoseconds>(
+        chrono::steady_clock::now() - session().epoch).count();
+    unsigned long long h = buffer.head.load(memory_order_relaxed);
+    buffer.ring[h & (buffer.ring.size() - 1)] = TraceRecord{now, arg, name, category, type};
+    buffer.head.store(h + 1, memory_order_release);
+}
+
+void setTraceThreadName(const string& name) {
+    localThreadName = name;
+    if (!tracingActive()) return;
+    ThreadTraceBuffer& buffer = threadBuffer();
+    lock_guard<mutex> guard(session().lock);
+    buffer.threadName = name;
+}
+
+
+// Export
+
+void writeChromeTrace(ostream& out) {
+    TraceSession& s = session();
+    lock_guard<mutex> guard(s.lock);
+
+    ios::fmtflags oldFlags = out.flags();
+    streamsize oldPrecision = out.precision();
+    out << fixed << setprecision(3);
+
+    out << "{\"traceEvents\": [\n";
+    bool first = true;
+    unsigned long long dropped = 0;
+    auto separator = [&]() { out << (first ? "  " : ",\n  "); first = false; };
+    for (const auto& buffer : s.buffers) {
+        separator();
+        out << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << buffer->tid
+            << ", \"args\": {\"name\": ";
+        writeJsonString(out, buffer->threadName);
+        out << "}}";
+
+        unsigned long long head = buffer->head.load(memory_order_acquire);
+        unsigned long long size = buffer->ring.size();
+        unsigned long long start = head > size ? head - size : 0;
+        dropped += start;
+        int depth = 0;
+        for (unsigned long long i = start; i < head; i++) {
+            const TraceRecord& r = buffer->ring[i & (size - 1)];
+            if (r.type == 'E') {
+                if (depth == 0) continue; // Its begin was overwritten
+                depth--;
+            } else {
+                depth++;
+            }
+            separator();
+            out << "{\"name\": \"" << r.name << "\", \"cat\": \"" << r.category << "\", \"ph\": \""
+                << r.type << "\", \"ts\": " << r.timestampNs * 1e-3 << ", \"pid\": 1, \"tid\": " << buffer->tid;
+            if (r.arg >= 0) out << ", \"args\": {\"id\": " << r.arg << "}";
+            out << "}";
+        }
+    }
+    out << "\n], \"displayTimeUnit\": \"ms\", \"otherData\": {\"dropped_events\": " << dropped << "}}\n";
+
+    out.flags(oldFlags);
+    out.precision(oldPrecision);
+}
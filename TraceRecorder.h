@@ -0,0 +1,63 @@
+#ifndef TRACE_RECORDER_H
+#define TRACE_RECORDER_H
+
+#include <string>
+#include <iostream>
+#include <cstddef>
+#include <atomic>
+
+using namespace std;
+
+
+// 1. Timeline Tracing (Chrome trace event format)
+
+
+// Every thread that records gets its own ring buffer, registered once on
+// its first event. Recording is a clock read plus a store into that buffer
+// (no locks, no allocation); when a ring is full the oldest events are
+// overwritten. While tracing is off a TraceScope costs one relaxed load.
+const size_t DEFAULT_TRACE_EVENTS_PER_THREAD = 1 << 18;
+
+// Starts a new session (dropping the previous one). The capacity is
+// rounded up to a power of two.
+void startTracing(size_t eventsPerThread = DEFAULT_TRACE_EVENTS_PER_THREAD);
+void stopTracing();
+
+extern atomic<bool> traceSessionActive;
+inline bool tracingActive() { return traceSessionActive.load(memory_order_relaxed); }
+
+// Low-level recording: type 'B' (begin) or 'E' (end). name and category
+// must be string literals (only the pointers are stored). arg < 0 means
+// "no argument", otherwise it shows up as args.id in the viewer.
+void traceEvent(char type, const char* name, const char* category, long long arg = -1);
+
+// Label for the calling thread in the timeline (default "thread <n>")
+void setTraceThreadName(const string& name);
+
+// Writes the session as Chrome trace JSON, loadable in chrome://tracing or
+// ui.perfetto.dev. Call it once the traced work has finished (after
+// stopTracing, or between solves); ends whose begin was overwritten are
+// dropped so the timeline stays well nested.
+void writeChromeTrace(ostream& out);
+
+// Begin/end pair around a scope: a phase, or one task of a parallel loop
+class TraceScope {
+private:
+    const char* name;
+    const char* category;
+    long long arg;
+    bool recording;
+
+public:
+    TraceScope(const char* n, const char* cat, long long a = -1)
+        : name(n), category(cat), arg(a), recording(tracingActive()) {
+        if (recording) traceEvent('B', name, category, arg);
+    }
+    ~TraceScope() {
+        if (recording) traceEvent('E', name, category, arg);
+    }
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+};
+
+#endif // TRACE_RECORDER_H
@@ -0,0 +1,73 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <random>
+#include "CircuitSolver.h"
+#include "CircuitGenerators.h"
+#include "PreparedSolve.h"
+#include "MemoryTracker.h"
+using namespace std;
+
+// Steady-state allocation check for PreparedSolve: after the first solve,
+// re-solving with new resistances and source values must not allocate.
+// Every generator family is prepared at a few sizes; the counting operator
+// new hook (MemoryTracker) tallies allocations around the re-solve loop.
+// Exit codes: 0 no allocations, 1 allocations seen, 77 hook not built in.
+
+const int RESOLVES = 40;
+
+static long long totalAllocations() {
+    MemorySnapshot snap = memorySnapshot();
+    long long total = 0;
+    for (const SubsystemMemory& s : snap.subsystems) total += s.allocations;
+    return total;
+}
+
+int main() {
+    if (!memoryHookInstalled()) {
+        cout << "alloctest: linked without the memory hook, nothing to count\n";
+        return 77;
+    }
+
+    int failures = 0;
+    for (CircuitFamily family : allFamilies()) {
+        for (long long nodes : {10LL, 200LL, 3000LL}) {
+            Circuit c;
+            buildCircuit(family, nodes, 7, c);
+            PreparedSolve prepared(c);
+            // The first install creates the voltage entries; published result
+            // snapshots are double-buffered, so it takes two to fill both
+            for (int warmup = 0; warmup < 2; warmup++) {
+                prepared.solve();
+                prepared.applyTo(c);
+            }
+
+            // New values are drawn before counting starts
+            mt19937 rng(11);
+            uniform_real_distribution<double> scale(0.5, 2.0);
+            vector<double> base(prepared.componentCount()), next(RESOLVES * base.size());
+            for (int k = 0; k < prepared.componentCount(); k++) base[k] = prepared.getValue(k);
+            for (double& s : next) s = scale(rng);
+
+            enableMemoryTracking();
+            long long before = totalAllocations();
+            for (int r = 0; r < RESOLVES; r++) {
+                // Odd rounds only touch sources, which reuses the factor
+                for (int k = 0; k < prepared.componentCount(); k++) {
+                    bool resistor = c.getComponents()[k]->getType() == RESISTOR;
+                    if (resistor && r % 2 == 1) continue;
+                    prepared.setValue(k, base[k] * next[r * base.size() + k]);
+                }
+                prepared.solve();
+                prepared.applyTo(c);
+            }
+            long long allocations = totalAllocations() - before;
+            enableMemoryTracking(false);
+
+            cout << familyName(family) << " " << nodes << " nodes: " << allocations
+                 << " allocation(s) in " << RESOLVES << " re-solves\n";
+            if (allocations != 0) failures++;
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
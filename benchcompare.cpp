@@ -0,0 +1,383 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <map>
+#include <random>
+#include <algorithm>
+#include <stdexcept>
+#include "CircuitAnalysis.h"
+using namespace std;
+
+// Regression gate: compares two JSON outputs of the benchmark suite case by
+// case. For every case present in both runs the change of the median is
+// bracketed by a bootstrap confidence interval; a case regresses when it
+// is slower beyond the threshold and the interval rules out "no change".
+// A baseline case the candidate lacks fails the gate too, unless allowed.
+// Exit codes: 0 no regression, 1 regression or missing case, 2 bad input
+// or usage.
+
+
+// 1. Minimal JSON Reader (just enough for the benchmark schema)
+
+
+struct JsonValue {
+    enum Kind { JSON_NULL, JSON_BOOL, JSON_NUMBER, JSON_STRING, JSON_ARRAY, JSON_OBJECT };
+    Kind kind = JSON_NULL;
+    double number = 0;
+    string text;
+    vector<JsonValue> items;
+    vector<pair<string, JsonValue>> members;
+
+    const JsonValue* get(const string& key) const {
+        for (const auto& m : members) if (m.first == key) return &m.second;
+        return nullptr;
+    }
+};
+
+class JsonParser {
+private:
+    const string& s;
+    size_t pos = 0;
+
+    void fail(const string& what) const {
+        throw runtime_error("JSON error at offset " + to_string(pos) + ": " + what);
+    }
+    void skipSpace() {
+        while (pos < s.size() && isspace((unsigned char)s[pos])) pos++;
+    }
+    void expect(char c) {
+        skipSpace();
+        if (pos >= s.size() || s[pos] != c) fail(string("expected '") + c + "'");
+        pos++;
+    }
+    bool consume(const char* word) {
+        size_t n = char_traits<char>::length(word);
+        if (s.compare(pos, n, word) != 0) return false;
+        pos += n;
+        return true;
+    }
+
+    string parseString() {
+        expect('"');
+        string out;
+        while (pos < s.size() && s[pos] != '"') {
+            char c = s[pos++];
+            if (c == '\\') {
+                if (pos >= s.size()) break;
+                char e = s[pos++];
+                switch (e) {
+                    case 'n': out += '\n'; break;
+                    case 't': out += '\t'; break;
+                    case 'r': out += '\r'; break;
+                    case 'b': out += '\b'; break;
+                    case 'f': out += '\f'; break;
+                    case 'u': pos += 4; out += '?'; break; // Not used by the benchmark output
+                    default: out += e;
+                }
+            } else {
+                out += c;
+            }
+        }
+        expect('"');
+        return out;
+    }
+
+public:
+    explicit JsonParser(const string& text) : s(text) {}
+
+    JsonValue parse() {
+        JsonValue v = parseValue();
+        skipSpace();
+        if (pos != s.size()) fail("trailing characters");
+        return v;
+    }
+
+    JsonValue parseValue() {
+        skipSpace();
+        if (pos >= s.size()) fail("unexpected end of input");
+        JsonValue v;
+        char c = s[pos];
+        if (c == '{') {
+            v.kind = JsonValue::JSON_OBJECT;
+            pos++;
+            skipSpace();
+            if (pos < s.size() && s[pos] == '}') { pos++; return v; }
+            while (true) {
+                string key = parseString();
+                expect(':');
+                v.members.emplace_back(key, parseValue());
+                skipSpace();
+                if (pos < s.size() && s[pos] == ',') { pos++; continue; }
+                expect('}');
+                return v;
+            }
+        }
+        if (c == '[') {
+            v.kind = JsonValue::JSON_ARRAY;
+            pos++;
+            skipSpace();
+            if (pos < s.size() && s[pos] == ']') { pos++; return v; }
+            while (true) {
+                v.items.push_back(parseValue());
+                skipSpace();
+                if (pos < s.size() && s[pos] == ',') { pos++; continue; }
+                expect(']');
+                return v;
+            }
+        }
+        if (c == '"') {
+            v.kind = JsonValue::JSON_STRING;
+            v.text = parseString();
+            return v;
+        }
+        if (consume("null")) return v;
+        if (consume("true")) { v.kind = JsonValue::JSON_BOOL; v.number = 1; return v; }
+        if (consume("false")) { v.kind = JsonValue::JSON_BOOL; return v; }
+
+        size_t used = 0;
+        try {
+            v.number = stod(s.substr(pos, 32), &used);
+        } catch (const exception&) {
+            fail("unexpected character");
+        }
+        v.kind = JsonValue::JSON_NUMBER;
+        pos += used;
+        return v;
+    }
+};
+
+
+// 2. Benchmark Runs
+
+
+struct BenchCase {
+    string solver;
+    vector<double> samples; // Seconds, one per timed repetition
+};
+
+// Cases keyed "family/nodes", reported in the order of the file
+struct BenchRun {
+    vector<string> order;
+    map<string, BenchCase> cases;
+};
+
+BenchRun loadRun(const string& path, const string& metric) {
+    ifstream in(path);
+    if (!in) throw runtime_error("Could not open " + path);
+    stringstream buffer;
+    buffer << in.rdbuf();
+    JsonValue root = JsonParser(buffer.str()).parse();
+
+    const JsonValue* results = root.get("results");
+    if (!results || results->kind != JsonValue::JSON_ARRAY) {
+        throw runtime_error(path + " is not a benchmark result file (no \"results\" array)");
+    }
+    BenchRun run;
+    for (const JsonValue& r : results->items) {
+        const JsonValue* family = r.get("family");
+        const JsonValue* nodes = r.get("nodes");
+        if (!family || !nodes) throw runtime_error(path + ": result without family/nodes");
+
+        const JsonValue* timing = nullptr;
+        if (metric == "total") {
+            timing = r.get("total");
+        } else if (const JsonValue* phases = r.get("phases")) {
+            timing = phases->get(metric);
+        }
+        const JsonValue* samples = timing ? timing->get("samples_s") : nullptr;
+        if (!samples) throw runtime_error(path + ": no samples for metric '" + metric + "'");
+
+        BenchCase c;
+        if (const JsonValue* solver = r.get("solver")) c.solver = solver->text;
+        for (const JsonValue& x : samples->items) c.samples.push_back(x.number);
+        if (c.samples.empty()) throw runtime_error(path + ": empty sample list");
+        string key = family->text + "/" + to_string((long long)nodes->number);
+        if (!run.cases.count(key)) run.order.push_back(key);
+        run.cases[key] = c;
+    }
+    return run;
+}
+
+
+// 3. Bootstrap Comparison
+
+
+double median(vector<double> samples) {
+    sort(samples.begin(), samples.end());
+    size_t n = samples.size();
+    return n % 2 ? samples[n / 2] : 0.5 * (samples[n / 2 - 1] + samples[n / 2]);
+}
+
+struct Comparison {
+    double baseMedian = 0, candidateMedian = 0;
+    double ratio = 1;            // candidate / baseline median
+    double ciLow = 1, ciHigh = 1; // Bootstrap interval of the ratio
+};
+
+// Percentile bootstrap: resample both runs with replacement and collect the
+// ratio of medians. With few repetitions the interval is wide (or, with one
+// sample per side, collapses to the point estimate).
+Comparison compareSamples(const vector<double>& base, const vector<double>& cand,
+                          int resamples, double confidence, mt19937_64& rng) {
+    Comparison c;
+    c.baseMedian = median(base);
+    c.candidateMedian = median(cand);
+    c.ratio = c.baseMedian > 0 ? c.candidateMedian / c.baseMedian : 1.0;
+
+    vector<double> ratios;
+    ratios.reserve(resamples);
+    vector<double> a(base.size()), b(cand.size());
+    uniform_int_distribution<size_t> pickBase(0, base.size() - 1), pickCand(0, cand.size() - 1);
+    for (int r = 0; r < resamples; r++) {
+        for (double& x : a) x = base[pickBase(rng)];
+        for (double& x : b) x = cand[pickCand(rng)];
+        double mb = median(a);
+        if (mb > 0) ratios.push_back(median(b) / mb);
+    }
+    if (ratios.empty()) return c;
+    sort(ratios.begin(), ratios.end());
+    double tail = (1.0 - confidence) / 2.0;
+    auto at = [&](double q) { return ratios[min(ratios.size() - 1, (size_t)(q * (ratios.size() - 1) + 0.5))]; };
+    c.ciLow = at(tail);
+    c.ciHigh = at(1.0 - tail);
+    return c;
+}
+
+
+// 4. Command Line
+
+
+struct CompareOptions {
+    string baselinePath, candidatePath;
+    string metric = "total";
+    double threshold = 0.05;  // Allowed slowdown of the median
+    double confidence = 0.95;
+    int resamples = 2000;
+    unsigned seed = 1;
+    bool allowMissing = false; // Baseline cases absent from the candidate pass
+};
+
+void printUsage(const char* program) {
+    cerr << "Usage: " << program << " <baseline.json> <candidate.json> [options]\n"
+         << "  --threshold <x>        allowed slowdown, e.g. 5% or 0.05 (default 5%)\n"
+         << "  --metric <name>        total (default) or a phase: parse, assemble, factor, solve, output\n"
+         << "  --confidence <p>       bootstrap interval level (default 0.95)\n"
+         << "  --resamples <n>        bootstrap resamples (default 2000)\n"
+         << "  --seed <n>             resampling seed (default 1)\n"
+         << "  --allow-missing        do not fail on baseline cases missing from the candidate\n"
+         << "Exit status: 0 no regression, 1 regression or missing case, 2 bad input\n";
+}
+
+double parseFraction(const string& text) {
+    bool percent = !text.empty() && text.back() == '%';
+    double value = stod(percent ? text.substr(0, text.size() - 1) : text);
+    return percent ? value / 100.0 : value;
+}
+
+string formatPercent(double ratio) {
+    ostringstream out;
+    out << showpos << fixed << setprecision(1) << (ratio - 1.0) * 100.0 << "%";
+    return out.str();
+}
+
+int main(int argc, char* argv[]) {
+    CompareOptions opt;
+    vector<string> positional;
+    try {
+        for (int i = 1; i < argc; i++) {
+            string arg = argv[i];
+            bool hasValue = i + 1 < argc;
+            if (arg.rfind("--", 0) != 0) {
+                positional.push_back(arg);
+                continue;
+            }
+            if (arg == "--allow-missing") {
+                opt.allowMissing = true;
+                continue;
+            }
+            if (!hasValue) throw invalid_argument("Missing value for " + arg);
+            string value = argv[++i];
+            if (arg == "--threshold") opt.threshold = parseFraction(value);
+            else if (arg == "--metric") opt.metric = value;
+            else if (arg == "--confidence") opt.confidence = stod(value);
+            else if (arg == "--resamples") opt.resamples = max(1, stoi(value));
+            else if (arg == "--seed") opt.seed = (unsigned)stoul(value);
+            else throw invalid_argument("Unknown option " + arg);
+        }
+        if (positional.size() != 2) throw invalid_argument("Expected a baseline and a candidate file");
+        if (!(opt.confidence > 0 && opt.confidence < 1)) throw invalid_argument("--confidence must be in (0, 1)");
+        if (opt.threshold < 0) throw invalid_argument("--threshold must not be negative");
+    } catch (const exception& e) {
+        cerr << "Error: " << e.what() << "\n";
+        printUsage(argv[0]);
+        return 2;
+    }
+    opt.baselinePath = positional[0];
+    opt.candidatePath = positional[1];
+
+    BenchRun base, cand;
+    try {
+        base = loadRun(opt.baselinePath, opt.metric);
+        cand = loadRun(opt.candidatePath, opt.metric);
+    } catch (const exception& e) {
+        cerr << "Error: " << e.what() << "\n";
+        return 2;
+    }
+
+    mt19937_64 rng(opt.seed);
+    int regressions = 0, compared = 0, missing = 0;
+    int ciPercent = (int)(opt.confidence * 100 + 0.5);
+    cout << left << setw(20) << "case" << setw(10) << "solver" << right << setw(12) << "baseline"
+         << setw(12) << "candidate" << setw(10) << "change" << setw(22) << (to_string(ciPercent) + "% interval")
+         << "  status\n";
+    for (const string& key : base.order) {
+        const BenchCase& b = base.cases[key];
+        auto it = cand.cases.find(key);
+        if (it == cand.cases.end()) {
+            cout << left << setw(20) << key << setw(10) << b.solver << right
+                 << setw(12) << formatSeconds(median(b.samples)) << setw(12) << "-"
+                 << setw(10) << "-" << setw(22) << "-"
+                 << (opt.allowMissing ? "  missing in candidate (allowed)\n" : "  MISSING in candidate\n");
+            missing++;
+            continue;
+        }
+        const BenchCase& c = it->second;
+        Comparison cmp = compareSamples(b.samples, c.samples, opt.resamples, opt.confidence, rng);
+        compared++;
+
+        string status;
+        if (cmp.ciLow > 1.0 && cmp.ratio > 1.0 + opt.threshold) { status = "REGRESSION"; regressions++; }
+        else if (cmp.ciLow > 1.0) status = "slower (within threshold)";
+        else if (cmp.ciHigh < 1.0) status = "faster";
+        else status = "no significant change";
+        if (b.solver != c.solver) status += " [solver " + b.solver + " -> " + c.solver + "]";
+
+        cout << left << setw(20) << key << setw(10) << c.solver << right
+             << setw(12) << formatSeconds(cmp.baseMedian) << setw(12) << formatSeconds(cmp.candidateMedian)
+             << setw(10) << formatPercent(cmp.ratio)
+             << setw(22) << ("[" + formatPercent(cmp.ciLow) + ", " + formatPercent(cmp.ciHigh) + "]")
+             << "  " << status << "\n";
+    }
+    for (const string& key : cand.order) {
+        if (!base.cases.count(key)) {
+            const BenchCase& c = cand.cases[key];
+            cout << left << setw(20) << key << setw(10) << c.solver << right
+                 << setw(12) << "-" << setw(12) << formatSeconds(median(c.samples))
+                 << setw(10) << "-" << setw(22) << "-" << "  new in candidate\n";
+        }
+    }
+
+    cout << "\n" << compared << " case(s) compared on '" << opt.metric << "', " << regressions
+         << " regression(s) beyond " << opt.threshold * 100 << "%, " << missing << " case(s) missing in candidate"
+         << (missing > 0 && opt.allowMissing ? " (allowed)" : "") << ".\n";
+    if (compared == 0) {
+        cerr << "Error: the two runs have no case in common.\n";
+        return 2;
+    }
+    return regressions > 0 || (missing > 0 && !opt.allowMissing) ? 1 : 0;
+}
+//cmake --build --preset release makes build/release/benchcompare
+// ./build/release/benchcompare baseline.json results.json --threshold 5%
@@ -0,0 +1,370 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <filesystem>
+#include <thread>
+#include "CircuitSolver.h"
+#include "CircuitAnalysis.h"
+#include "CircuitGenerators.h"
+#include "TraceRecorder.h"
+#include "MemoryTracker.h"
+using namespace std;
+
+// Benchmark harness: every generated family is pushed through the same
+// public calls as the CLI (loadCircuit -> solve -> displayResults), with the
+// phases (parse, assemble, factor, solve, output) read from SolverStats,
+// and the dense gaussianElimination() path is timed alongside as the
+// baseline.
+
+const char* const BENCH_PHASES[] = {"parse", "assemble", "factor", "solve", "output"};
+const int BENCH_PHASE_COUNT = 5;
+
+struct BenchmarkOptions {
+    vector<CircuitFamily> families = allFamilies();
+    vector<long long> sizes;
+    long long maxNodes = 10000;
+    int warmup = 1;
+    int repetitions = 5;
+    unsigned seed = 1;
+    size_t maxMemory = size_t(2) << 30; // Memory budget of every solve (see Circuit::setMaxMemory)
+    int denseLimit = 1500;              // Largest MNA size timed with the dense baseline
+    string jsonPath;
+    string tracePath;
+    bool trackMemory = false; // Peak heap per case (counting operator new)
+};
+
+struct CaseResult {
+    CircuitFamily family;
+    long long nodes = 0;
+    long long components = 0;
+    int unknowns = 0;
+    int mnaSize = 0;
+    string solver;
+    vector<double> phaseSeconds[BENCH_PHASE_COUNT];
+    vector<double> totalSeconds;
+    vector<double> baselineSeconds; // Empty when the dense path is too large
+    long long heapPeakBytes = -1;   // Load through output, -1 when not tracked
+};
+
+
+// Helper: stream buffer that formats and throws away (timing output without I/O)
+
+class DiscardBuffer : public streambuf {
+    char buffer[4096];
+public:
+    DiscardBuffer() { setp(buffer, buffer + sizeof(buffer)); }
+protected:
+    int overflow(int c) override { setp(buffer, buffer + sizeof(buffer)); return c; }
+};
+
+// Helper: statistics over repetitions
+
+double percentile(vector<double> samples, double p) {
+    if (samples.empty()) return 0.0;
+    sort(samples.begin(), samples.end());
+    size_t rank = (size_t)ceil(p * samples.size());
+    return samples[min(samples.size() - 1, rank == 0 ? 0 : rank - 1)];
+}
+
+double median(const vector<double>& samples) {
+    if (samples.empty()) return 0.0;
+    vector<double> s = samples;
+    sort(s.begin(), s.end());
+    size_t n = s.size();
+    return n % 2 ? s[n / 2] : 0.5 * (s[n / 2 - 1] + s[n / 2]);
+}
+
+// The dense baseline covers assembly and elimination only, so speedups are
+// measured against the same span of the sparse pipeline
+double solverSeconds(const CaseResult& r) {
+    return median(r.phaseSeconds[1]) + median(r.phaseSeconds[2]) + median(r.phaseSeconds[3]);
+}
+
+double seconds(chrono::steady_clock::time_point from) {
+    return chrono::duration<double>(chrono::steady_clock::now() - from).count();
+}
+
+// Short name of the backend solve() picked (a table column and JSON value)
+const char* backendTag(SolverBackend backend) {
+    switch (backend) {
+    case BACKEND_DENSE: return "dense";
+    case BACKEND_SPARSE_DIRECT: return "cholesky";
+    case BACKEND_ITERATIVE: return "pcg";
+    case BACKEND_OUT_OF_CORE: return "ooc-chol";
+    case BACKEND_CACHED: return "cached";
+    default: return "auto";
+    }
+}
+
+
+// Helper: one family at one size
+
+CaseResult runCase(CircuitFamily family, long long nodes, const BenchmarkOptions& opt) {
+    CaseResult result;
+    result.family = family;
+
+    string path = (filesystem::temp_directory_path() /
+                   ("circuit_bench_" + to_string(chrono::steady_clock::now().time_since_epoch().count()) + ".txt")).string();
+    {
+        ofstream out(path);
+        result.components = writeCircuit(family, nodes, opt.seed, out);
+    }
+
+    DiscardBuffer discard;
+    ostream sink(&discard);
+
+    // Counts only; the solver is whatever solve() picks in the timed runs
+    {
+        Circuit c;
+        Status loaded = c.loadCircuit(path);
+        if (!loaded) throw runtime_error(loaded.error);
+        result.nodes = c.getNodeCount();
+        result.mnaSize = c.getNodeCount();
+        for (const auto& comp : c.getComponents()) if (comp->getType() == VOLTAGE_SOURCE) result.mnaSize++;
+    }
+
+    for (int rep = 0; rep < opt.warmup + opt.repetitions; rep++) {
+        TraceScope repScope(rep < opt.warmup ? "warmup" : "repetition", "benchmark", rep);
+        if (opt.trackMemory) beginMemoryPhase();
+        Circuit c;
+        c.enableStats();
+        c.setMaxMemory(opt.maxMemory);
+
+        // The CLI's path through the public API; the phase split comes
+        // from the circuit's own stats
+        auto start = chrono::steady_clock::now();
+        Status status = c.loadCircuit(path);
+        if (status) status = c.solve();
+        if (!status) throw runtime_error(status.error);
+        c.displayResults(sink);
+        double total = seconds(start);
+        if (opt.trackMemory && rep >= opt.warmup) result.heapPeakBytes = max(result.heapPeakBytes, phaseHeapPeakBytes());
+
+        const SolverStats& stats = c.getStats();
+        auto wall = [&stats](StatPhase phase) { return stats.phases[phase].wallSeconds; };
+        double t[BENCH_PHASE_COUNT] = {
+            wall(PHASE_LOAD) + wall(PHASE_INTERNING),
+            wall(PHASE_ASSEMBLY),
+            wall(PHASE_ORDERING) + wall(PHASE_FACTORIZATION),
+            wall(PHASE_TRIANGULAR_SOLVE) + wall(PHASE_ITERATIVE_SOLVE),
+            wall(PHASE_OUTPUT),
+        };
+        result.unknowns = stats.unknowns;
+        result.solver = backendTag(c.getLastBackend());
+
+        double baseline = -1.0;
+        if (result.mnaSize <= opt.denseLimit) {
+            start = chrono::steady_clock::now();
+            vector<vector<double>> A;
+            vector<double> B;
+            assembleMNA(c, A, B);
+            gaussianElimination(move(A), move(B));
+            baseline = seconds(start);
+        }
+
+        if (rep < opt.warmup) continue;
+        for (int p = 0; p < BENCH_PHASE_COUNT; p++) result.phaseSeconds[p].push_back(t[p]);
+        result.totalSeconds.push_back(total);
+        if (baseline >= 0.0) result.baselineSeconds.push_back(baseline);
+    }
+    filesystem::remove(path);
+    return result;
+}
+
+
+// Helper: report writers
+
+void printTable(const vector<CaseResult>& results, ostream& out) {
+    out << left << setw(10) << "family" << right << setw(10) << "nodes" << setw(10) << "solver";
+    for (const char* phase : BENCH_PHASES) out << setw(11) << phase;
+    out << setw(11) << "total" << setw(11) << "p95" << setw(13) << "nodes/s" << setw(11) << "dense" << setw(9) << "speedup\n";
+    for (const auto& r : results) {
+        double total = median(r.totalSeconds);
+        out << left << setw(10) << familyName(r.family) << right << setw(10) << r.nodes << setw(10) << r.solver;
+        for (int p = 0; p < BENCH_PHASE_COUNT; p++) out << setw(11) << formatSeconds(median(r.phaseSeconds[p]));
+        out << setw(11) << formatSeconds(total) << setw(11) << formatSeconds(percentile(r.totalSeconds, 0.95))
+            << setw(13) << scientific << setprecision(2) << r.nodes / total << defaultfloat;
+        if (r.baselineSeconds.empty()) {
+            out << setw(11) << "-" << setw(9) << "-";
+        } else {
+            double dense = median(r.baselineSeconds);
+            out << setw(11) << formatSeconds(dense) << setw(8) << fixed << setprecision(1) << dense / solverSeconds(r) << "x"
+                << defaultfloat;
+        }
+        out << "\n";
+    }
+}
+
+void writeSamples(ostream& out, const vector<double>& samples) {
+    out << "{\"median_s\": " << median(samples) << ", \"p95_s\": " << percentile(samples, 0.95)
+        << ", \"samples_s\": [";
+    for (size_t i = 0; i < samples.size(); i++) out << (i ? ", " : "") << samples[i];
+    out << "]}";
+}
+
+void writeJson(const vector<CaseResult>& results, const BenchmarkOptions& opt, ostream& out) {
+    out << setprecision(9);
+    out << "{\n  \"schema\": 1,\n";
+    out << "  \"config\": {\"warmup\": " << opt.warmup << ", \"repetitions\": " << opt.repetitions
+        << ", \"seed\": " << opt.seed << ", \"max_memory_bytes\": " << opt.maxMemory
+        << ", \"dense_limit\": " << opt.denseLimit << "},\n";
+    out << "  \"machine\": {\"threads\": " << thread::hardware_concurrency()
+        << ", \"dense_flop_rate\": " << machineFlopRate() << "},\n";
+    out << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const CaseResult& r = results[i];
+        double total = median(r.totalSeconds);
+        out << "    {\"family\": \"" << familyName(r.family) << "\", \"nodes\": " << r.nodes
+            << ", \"components\": " << r.components << ", \"unknowns\": " << r.unknowns
+            << ", \"mna_size\": " << r.mnaSize << ", \"solver\": \"" << r.solver << "\",\n";
+        out << "     \"phases\": {";
+        for (int p = 0; p < BENCH_PHASE_COUNT; p++) {
+            out << (p ? ", " : "") << "\"" << BENCH_PHASES[p] << "\": ";
+            writeSamples(out, r.phaseSeconds[p]);
+        }
+        out << "},\n     \"total\": ";
+        writeSamples(out, r.totalSeconds);
+        out << ",\n     \"throughput_nodes_per_s\": " << (total > 0 ? r.nodes / total : 0.0)
+            << ", \"throughput_components_per_s\": " << (total > 0 ? r.components / total : 0.0) << ",\n";
+        if (r.heapPeakBytes >= 0) {
+            out << "     \"heap_peak_bytes\": " << r.heapPeakBytes
+                << ", \"heap_peak_bytes_per_node\": " << (r.nodes > 0 ? double(r.heapPeakBytes) / r.nodes : 0.0) << ",\n";
+        }
+        out << "     \"baseline\": ";
+        if (r.baselineSeconds.empty()) {
+            out << "null, \"speedup_vs_baseline\": null}";
+        } else {
+            writeSamples(out, r.baselineSeconds);
+            out << ", \"speedup_vs_baseline\": " << median(r.baselineSeconds) / solverSeconds(r) << "}";
+        }
+        out << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    out << "  ]\n}\n";
+}
+
+
+// Helper: comma-separated list parsing for the command line
+
+vector<string> splitList(const string& text) {
+    vector<string> items;
+    stringstream ss(text);
+    string item;
+    while (getline(ss, item, ',')) if (!item.empty()) items.push_back(item);
+    return items;
+}
+
+void printUsage(const char* program) {
+    cerr << "Usage: " << program << " [options]\n"
+         << "  --families <a,b,..>    ladder, grid2d, grid3d, random, tree, star, vsources (default: all)\n"
+         << "  --sizes <n,n,..>       node counts (default: powers of 10 from 10 to --max-nodes)\n"
+         << "  --max-nodes <n>        largest default size (default 10000, up to 10000000)\n"
+         << "  --warmup <n>           untimed runs per case (default 1)\n"
+         << "  --repetitions <n>      timed runs per case (default 5)\n"
+         << "  --seed <n>             generator seed (default 1)\n"
+         << "  --max-memory <size>    memory budget the solver picks a backend under (default 2G)\n"
+         << "  --dense-limit <n>      largest MNA size for the dense baseline (default 1500)\n"
+         << "  --json <file>          also write machine-readable results ('-' for stdout)\n"
+         << "  --trace <file>         record a Chrome trace timeline of all runs\n"
+         << "  --memory               also record the peak heap of every case\n";
+}
+
+int main(int argc, char* argv[]) {
+    BenchmarkOptions opt;
+    try {
+        for (int i = 1; i < argc; i++) {
+            string arg = argv[i];
+            bool hasValue = i + 1 < argc;
+            string value = hasValue ? argv[i + 1] : "";
+            if (arg == "--families" && hasValue) {
+                opt.families.clear();
+                for (const string& name : splitList(value)) {
+                    CircuitFamily f;
+                    if (!parseFamily(name, f)) throw invalid_argument("Unknown family '" + name + "'");
+                    opt.families.push_back(f);
+                }
+            } else if (arg == "--sizes" && hasValue) {
+                for (const string& n : splitList(value)) opt.sizes.push_back((long long)stod(n));
+            } else if (arg == "--max-nodes" && hasValue) {
+                opt.maxNodes = (long long)stod(value);
+            } else if (arg == "--warmup" && hasValue) {
+                opt.warmup = stoi(value);
+            } else if (arg == "--repetitions" && hasValue) {
+                opt.repetitions = max(1, stoi(value));
+            } else if (arg == "--seed" && hasValue) {
+                opt.seed = (unsigned)stoul(value);
+            } else if (arg == "--max-memory" && hasValue) {
+                if (!parseByteSize(value, opt.maxMemory)) throw invalid_argument("Bad size '" + value + "'");
+            } else if (arg == "--dense-limit" && hasValue) {
+                opt.denseLimit = stoi(value);
+            } else if (arg == "--json" && hasValue) {
+                opt.jsonPath = value;
+            } else if (arg == "--memory") {
+                opt.trackMemory = true;
+                continue; // Takes no value
+            } else if (arg == "--trace" && hasValue) {
+                opt.tracePath = value;
+            } else {
+                printUsage(argv[0]);
+                return 1;
+            }
+            i++;
+        }
+    } catch (const exception& e) {
+        cerr << "Error: " << e.what() << "\n";
+        printUsage(argv[0]);
+        return 1;
+    }
+    if (opt.sizes.empty()) {
+        for (long long n = 10; n <= opt.maxNodes; n *= 10) opt.sizes.push_back(n);
+    }
+
+    if (opt.trackMemory) {
+        if (!memoryHookInstalled()) cerr << "Warning: linked without the memory hook, heap peaks stay 0\n";
+        enableMemoryTracking();
+    }
+    if (!opt.tracePath.empty()) {
+        startTracing();
+        setTraceThreadName("benchmark");
+    }
+
+    vector<CaseResult> results;
+    int failures = 0;
+    for (CircuitFamily family : opt.families) {
+        for (long long nodes : opt.sizes) {
+            cerr << "Running " << familyName(family) << " with " << nodes << " nodes..." << endl;
+            TraceScope caseScope(familyName(family), "case", nodes);
+            try {
+                results.push_back(runCase(family, nodes, opt));
+            } catch (const exception& e) {
+                cerr << "  skipped: " << e.what() << endl;
+                failures++;
+            }
+        }
+    }
+
+    bool jsonToStdout = opt.jsonPath == "-";
+    printTable(results, jsonToStdout ? cerr : cout);
+    if (!opt.jsonPath.empty()) {
+        if (jsonToStdout) {
+            writeJson(results, opt, cout);
+        } else {
+            ofstream out(opt.jsonPath);
+            if (!out) { cerr << "Error: Could not write " << opt.jsonPath << "\n"; return 1; }
+            writeJson(results, opt, out);
+        }
+    }
+    if (!opt.tracePath.empty()) {
+        stopTracing();
+        ofstream out(opt.tracePath);
+        if (!out) { cerr << "Error: Could not write " << opt.tracePath << "\n"; return 1; }
+        writeChromeTrace(out);
+    }
+    return failures == 0 ? 0 : 2; // Non-zero when any case failed
+}
+//cmake --build --preset release makes build/release/benchmark
+// ./build/release/benchmark --max-nodes 100000 --json results.json
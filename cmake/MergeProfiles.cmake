@@ -0,0 +1,14 @@
+# Merge the raw Clang profiles of a PGO training run into default.profdata
+# Usage: cmake -DLLVM_PROFDATA=<tool> -DPROFILE_DIR=<dir> -P MergeProfiles.cmake
+
+file(GLOB RAW_PROFILES "${PROFILE_DIR}/*.profraw")
+if(NOT RAW_PROFILES)
+    message(FATAL_ERROR "No .profraw files in ${PROFILE_DIR}; run an instrumented (GENERATE) build first")
+endif()
+execute_process(
+    COMMAND "${LLVM_PROFDATA}" merge "-output=${PROFILE_DIR}/default.profdata" ${RAW_PROFILES}
+    RESULT_VARIABLE MERGE_RESULT
+)
+if(NOT MERGE_RESULT EQUAL 0)
+    message(FATAL_ERROR "llvm-profdata merge failed (${MERGE_RESULT})")
+endif()
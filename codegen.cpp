@@ -0,0 +1,69 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <stdexcept>
+#include "CircuitSolver.h"
+#include "CodeGenerator.h"
+using namespace std;
+
+// Writes the straight-line solver of a saved netlist (see
+// generateSolverSource()) as C++ source, for projects that compile it in
+// ahead of time instead of loading it at run time.
+// Exit codes: 0 written, 1 the circuit cannot be solved, 2 bad input or usage.
+
+static void printUsage(const char* program) {
+    cerr << "Usage: " << program << " <netlist> [options]\n"
+         << "  --name <symbol>   name of the generated function (default circuit_generated_solve)\n"
+         << "  --out <file>      write the source there instead of to stdout\n";
+}
+
+int main(int argc, char* argv[]) {
+    string netlist, name = "circuit_generated_solve", outPath;
+    try {
+        for (int i = 1; i < argc; i++) {
+            string arg = argv[i];
+            if (arg.rfind("--", 0) != 0) {
+                if (!netlist.empty()) throw invalid_argument("Expected one netlist");
+                netlist = arg;
+                continue;
+            }
+            if (i + 1 >= argc) throw invalid_argument("Missing value for " + arg);
+            string value = argv[++i];
+            if (arg == "--name") name = value;
+            else if (arg == "--out") outPath = value;
+            else throw invalid_argument("Unknown option " + arg);
+        }
+        if (netlist.empty()) throw invalid_argument("Expected a netlist");
+    } catch (const exception& e) {
+        cerr << "Error: " << e.what() << "\n";
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    Circuit circuit;
+    Status loaded = circuit.loadCircuit(netlist);
+    if (!loaded) {
+        cerr << "Error: " << loaded.error << "\n";
+        return 2;
+    }
+    string source;
+    try {
+        source = generateSolverSource(circuit, name);
+    } catch (const exception& e) {
+        cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+
+    if (outPath.empty()) {
+        cout << source;
+        return 0;
+    }
+    ofstream out(outPath);
+    out << source;
+    if (!out) {
+        cerr << "Error: cannot write " << outPath << "\n";
+        return 2;
+    }
+    cerr << "Wrote " << name << "() for " << circuit.getComponents().size() << " components to " << outPath << "\n";
+    return 0;
+}
@@ -0,0 +1,391 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <cmath>
+#include <filesystem>
+#include "CircuitSolver.h"
+#include "CircuitGenerators.h"
+#include "SolveScheduler.h"
+using namespace std;
+
+// Concurrency checks of the public Circuit API, one section per feature.
+// Each check prints a line and counts its failures.
+// Exit codes: 0 all checks passed, 1 otherwise.
+
+
+// 1. Snapshot Readers During Edits and Re-solves
+
+
+// One writer grows a resistor chain driven by a 10 V source, re-solving
+// after every edit; readers meanwhile check that every snapshot they load is
+// self-consistent: the source node at 10 V, voltages falling strictly along
+// the chain, a name table matching the voltage vector, and versions that
+// never go backwards.
+int checkSnapshotReaders() {
+    const int STEPS = 300, READERS = 4;
+    Circuit c;
+    c.addVoltageSource("V1", "n1", "GND", 10.0);
+    c.addResistor("R1", "n1", "GND", 1.0);
+    c.solve();
+
+    atomic<bool> done{false};
+    atomic<int> failures{0};
+    atomic<long long> loaded{0};
+    vector<thread> readers;
+    for (int r = 0; r < READERS; r++) {
+        readers.emplace_back([&]() {
+            unsigned long long lastVersion = 0;
+            while (!done.load()) {
+                shared_ptr<const ResultSnapshot> snap = c.snapshot();
+                if (!snap) { failures++; continue; }
+                loaded++;
+                bool ok = snap->version >= lastVersion && fabs(snap->voltage("n1") - 10.0) < 1e-9;
+                lastVersion = snap->version;
+                int maxID = 0;
+                for (const auto& entry : *snap->nodeIDs) maxID = max(maxID, entry.second);
+                ok = ok && maxID + 1 == (int)snap->voltages.size();
+                double previous = snap->voltage("n1");
+                for (int k = 2; k <= maxID; k++) {
+                    double v = snap->voltage("n" + to_string(k));
+                    ok = ok && isfinite(v) && v < previous && v > 0;
+                    previous = v;
+                }
+                if (!ok) failures++;
+            }
+        });
+    }
+
+    for (int k = 2; k <= STEPS; k++) {
+        c.addResistor("Rs" + to_string(k), "n" + to_string(k - 1), "n" + to_string(k), 1.0);
+        c.addResistor("Rg" + to_string(k), "n" + to_string(k), "GND", 2.0);
+        if (!c.solve()) failures++;
+    }
+    done = true;
+    for (thread& t : readers) t.join();
+
+    shared_ptr<const ResultSnapshot> last = c.snapshot();
+    if (!last || (int)last->voltages.size() != STEPS + 1) failures++;
+    cout << "snapshot readers: " << loaded.load() << " snapshot(s) read during " << STEPS
+         << " re-solves, " << failures.load() << " failure(s)\n";
+    return failures.load();
+}
+
+
+// 2. Forked Variants Solved in Parallel
+
+
+// Variants of one solved base mesh, each with its own resistor changes, are
+// solved concurrently on their own threads (sharing the base's components
+// and symbolic analysis). Each must match a circuit built from scratch with
+// the same changes, and the base must not see any of them.
+int checkForkedVariants() {
+    const int VARIANTS = 16, NODES = 2500;
+    Circuit base;
+    buildCircuit(FAMILY_GRID_2D, NODES, 3, base);
+    base.setBackend(BACKEND_SPARSE_DIRECT);
+    int failures = base.solve() ? 0 : 1;
+    vector<double> baseValues;
+    for (const auto& comp : base.getComponents()) baseValues.push_back(comp->value);
+
+    // Variant v scales every (v+7)-th resistor by 1 + v/4
+    auto change = [](Circuit& c, int v) {
+        const ComponentList& list = c.getComponents();
+        for (int k = v; k < (int)list.size(); k += v + 7) {
+            if (list[k]->getType() == RESISTOR) c.setComponentValue(k, list[k]->value * (1.0 + v / 4.0));
+        }
+    };
+
+    vector<unique_ptr<Circuit>> variants;
+    for (int v = 0; v < VARIANTS; v++) {
+        variants.push_back(base.fork());
+        change(*variants.back(), v);
+    }
+    vector<Status> outcomes(VARIANTS);
+    vector<thread> workers;
+    for (int v = 0; v < VARIANTS; v++) {
+        workers.emplace_back([&, v]() { outcomes[v] = variants[v]->solve(); });
+    }
+    for (thread& t : workers) t.join();
+
+    double worst = 0;
+    for (int v = 0; v < VARIANTS; v++) {
+        Circuit fresh;
+        buildCircuit(FAMILY_GRID_2D, NODES, 3, fresh);
+        change(fresh, v);
+        if (!outcomes[v] || !fresh.solve()) { failures++; continue; }
+        for (const auto& entry : fresh.getNodeVoltages()) {
+            auto it = variants[v]->getNodeVoltages().find(entry.first);
+            if (it == variants[v]->getNodeVoltages().end()) { failures++; break; }
+            worst = max(worst, fabs(it->second - entry.second));
+        }
+    }
+    if (worst > 1e-9) failures++;
+    for (size_t k = 0; k < baseValues.size(); k++) {
+        if (base.getComponents()[k]->value != baseValues[k]) { failures++; break; }
+    }
+    cout << "forked variants: " << VARIANTS << " solved in parallel, worst difference " << worst
+         << " V, " << failures << " failure(s)\n";
+    return failures;
+}
+
+
+// 3. Asynchronous Solves: Progress, Adoption and Cancellation
+
+
+// An async solve of a sparse mesh must report factorization progress up to
+// 1.0 and give the same voltages as a synchronous solve once adopted. Large
+// iterative solves must stop early, with `cancelled` set, both when cancel()
+// is called and when the circuit is edited mid-solve; an edited circuit must
+// then refuse the stale results.
+int checkAsyncSolves() {
+    int failures = 0;
+    Circuit c;
+    buildCircuit(FAMILY_GRID_2D, 2500, 5, c);
+    c.setBackend(BACKEND_SPARSE_DIRECT);
+    atomic<int> reports{0};
+    atomic<bool> monotone{true};
+    double lastFraction = 0; // Only touched by the solving thread
+    SolveTask task = c.solveAsync([&](const SolveProgress& p) {
+        if (p.fraction < lastFraction) monotone = false;
+        lastFraction = p.fraction;
+        reports++;
+    });
+    AsyncSolveResult outcome = task.result.get();
+    if (!outcome.status || outcome.cancelled || !monotone || fabs(lastFraction - 1.0) > 1e-12) failures++;
+    if (!outcome.results || !c.adoptResults(*outcome.results)) failures++;
+    Circuit fresh;
+    buildCircuit(FAMILY_GRID_2D, 2500, 5, fresh);
+    double worst = fresh.solve() ? 0 : 1;
+    for (const auto& entry : fresh.getNodeVoltages()) {
+        auto it = c.getNodeVoltages().find(entry.first);
+        worst = max(worst, it == c.getNodeVoltages().end() ? 1.0 : fabs(it->second - entry.second));
+    }
+    if (worst > 1e-9) failures++;
+
+    // Cancelled once CG is under way, by cancel() and then by an edit
+    Circuit big;
+    buildCircuit(FAMILY_GRID_2D, 100000, 5, big);
+    big.setBackend(BACKEND_ITERATIVE);
+    int cancelled = 0;
+    for (int round = 0; round < 2; round++) {
+        atomic<int> iterations{0};
+        SolveTask run = big.solveAsync([&](const SolveProgress& p) { iterations = p.iteration; });
+        while (iterations.load() < 5) this_thread::yield();
+        if (round == 0) run.cancel();
+        else big.addResistor("Rextra", "n1", "GND", 1.0);
+        AsyncSolveResult stopped = run.result.get();
+        if (stopped.cancelled && !stopped.status && !stopped.results) cancelled++;
+        else failures++;
+        if (round == 1 && stopped.results && big.adoptResults(*stopped.results)) failures++;
+    }
+
+    cout << "async solves: " << reports.load() << " progress report(s), worst difference " << worst
+         << " V, " << cancelled << " of 2 cancelled, " << failures << " failure(s)\n";
+    return failures;
+}
+
+
+// 4. Work-stealing Scheduler: Priorities, Subtrees and Quotas
+
+
+// Helper: largest voltage difference between two solved circuits with the
+// same node names (infinite if a node is missing)
+static double largestDifference(const Circuit& a, const Circuit& b) {
+    double worst = 0;
+    for (const auto& entry : a.getNodeVoltages()) {
+        auto it = b.getNodeVoltages().find(entry.first);
+        if (it == b.getNodeVoltages().end()) return INFINITY;
+        worst = max(worst, fabs(it->second - entry.second));
+    }
+    return worst;
+}
+
+// Large batch factorizations occupy all workers but one; interactive jobs
+// submitted after them must all finish first. The batch results, factorized
+// with their subtrees spread over the workers, must be bitwise the serial
+// ones. A job whose quota rules out the sparse factor must still be solved
+// (by CG), and a quota over the limit must be refused.
+int checkScheduler() {
+    const int WORKERS = 4, BATCH = 3, INTERACTIVE = 40;
+    int failures = 0;
+    SolveScheduler scheduler(WORKERS, 1ull << 40);
+
+    vector<unique_ptr<Circuit>> batch, small;
+    vector<future<Status>> batchDone, smallDone;
+    for (int j = 0; j < BATCH; j++) {
+        batch.push_back(make_unique<Circuit>());
+        buildCircuit(FAMILY_GRID_2D, 100000, 20 + j, *batch.back());
+        batch.back()->setBackend(BACKEND_SPARSE_DIRECT);
+        JobOptions options;
+        options.priority = PRIORITY_BATCH;
+        options.memoryQuota = 1ull << 34;
+        batchDone.push_back(scheduler.submit(*batch.back(), options));
+    }
+    vector<CircuitFamily> families = allFamilies();
+    for (int j = 0; j < INTERACTIVE; j++) {
+        small.push_back(make_unique<Circuit>());
+        buildCircuit(families[j % families.size()], 300, 40 + j, *small.back());
+        JobOptions options;
+        options.priority = PRIORITY_INTERACTIVE;
+        options.memoryQuota = 1ull << 24;
+        smallDone.push_back(scheduler.submit(*small.back(), options));
+    }
+    for (auto& done : smallDone) if (!done.get()) failures++;
+    int batchFinished = 0;
+    for (auto& done : batchDone) {
+        if (done.wait_for(chrono::seconds(0)) == future_status::ready) batchFinished++;
+    }
+    if (batchFinished > 0) failures++;
+
+    double worst = 0;
+    for (int j = 0; j < BATCH; j++) {
+        if (!batchDone[j].get()) { failures++; continue; }
+        Circuit serial;
+        buildCircuit(FAMILY_GRID_2D, 100000, 20 + j, serial);
+        serial.setBackend(BACKEND_SPARSE_DIRECT);
+        if (!serial.solve()) failures++;
+        worst = max(worst, largestDifference(serial, *batch[j]));
+    }
+    if (worst != 0) failures++;
+
+    // A 4 MB quota rules out the factor of a 20000-node mesh
+    Circuit tight;
+    buildCircuit(FAMILY_GRID_2D, 20000, 9, tight);
+    JobOptions quota;
+    quota.memoryQuota = 4 << 20;
+    Status tightStatus = scheduler.submit(tight, quota).get();
+    if (!tightStatus || tight.getLastBackend() != BACKEND_ITERATIVE || tight.getMaxMemory() != 0) failures++;
+    bool refused = false;
+    try {
+        quota.memoryQuota = (1ull << 40) + 1;
+        scheduler.submit(tight, quota);
+    } catch (const invalid_argument&) {
+        refused = true;
+    }
+    if (!refused) failures++;
+
+    SchedulerCounters counters = scheduler.counters();
+    if (counters.jobs != BATCH + INTERACTIVE + 1) failures++;
+    cout << "scheduler: " << counters.jobs << " job(s), " << counters.tasks << " subtree task(s), "
+         << counters.stolen << " stolen, " << batchFinished << " batch job(s) done before the interactive ones, "
+         << "batch difference " << worst << " V, " << failures << " failure(s)\n";
+    return failures;
+}
+
+// Under a memory limit, a batch job reserving everything jobs that are not
+// interactive may reserve must neither hold back jobs with the default
+// quota (which reserve nothing and keep the circuit's own budget) nor
+// interactive jobs, which start in the reserve kept for them. A job that
+// is not interactive asking for more than its share is refused.
+int checkDefaultQuotas() {
+    const int WORKERS = 4, NORMAL = 6, INTERACTIVE = 2;
+    const size_t LIMIT = 1ull << 30;
+    const size_t SHARE = LIMIT - LIMIT / WORKERS;
+    int failures = 0;
+    SolveScheduler scheduler(WORKERS, LIMIT);
+
+    Circuit large;
+    buildCircuit(FAMILY_GRID_2D, 100000, 60, large);
+    large.setBackend(BACKEND_SPARSE_DIRECT);
+    JobOptions batchOptions;
+    batchOptions.priority = PRIORITY_BATCH;
+    batchOptions.memoryQuota = SHARE;
+    future<Status> batchDone = scheduler.submit(large, batchOptions);
+
+    vector<unique_ptr<Circuit>> small;
+    vector<future<Status>> smallDone;
+    vector<CircuitFamily> families = allFamilies();
+    for (int j = 0; j < NORMAL + INTERACTIVE; j++) {
+        small.push_back(make_unique<Circuit>());
+        buildCircuit(families[j % families.size()], 300, 70 + j, *small.back());
+        JobOptions options;
+        if (j >= NORMAL) {
+            options.priority = PRIORITY_INTERACTIVE;
+            options.memoryQuota = LIMIT / 8;
+        }
+        smallDone.push_back(scheduler.submit(*small.back(), options));
+    }
+    for (auto& done : smallDone) if (!done.get()) failures++;
+    bool batchFirst = batchDone.wait_for(chrono::seconds(0)) == future_status::ready;
+    if (batchFirst) failures++;
+    for (int j = 0; j < NORMAL; j++) {
+        if (small[j]->getMaxMemory() != 0) failures++;
+    }
+
+    bool refused = false;
+    try {
+        JobOptions tooLarge;
+        tooLarge.memoryQuota = SHARE + 1;
+        scheduler.submit(large, tooLarge);
+    } catch (const invalid_argument&) {
+        refused = true;
+    }
+    if (!refused) failures++;
+    if (!batchDone.get()) failures++;
+
+    cout << "default quotas: " << NORMAL << " default and " << INTERACTIVE << " interactive job(s) "
+         << (batchFirst ? "behind" : "beside") << " a batch job holding the background share, "
+         << failures << " failure(s)\n";
+    return failures;
+}
+
+
+// 5. Cache Directories Shared by Concurrent Writers
+
+
+// Several circuits, identical, solve at once into one factor and one result
+// cache directory, so every writer replaces the same two files. All must
+// succeed with the same voltages, and no temporary file may be left behind.
+int checkSharedCaches() {
+    const int WRITERS = 6;
+    int failures = 0;
+    filesystem::path dir = filesystem::temp_directory_path() / "concurrencytest-caches";
+    filesystem::remove_all(dir);
+    filesystem::create_directories(dir);
+
+    vector<unique_ptr<Circuit>> circuits;
+    vector<Status> statuses(WRITERS);
+    vector<thread> writers;
+    for (int w = 0; w < WRITERS; w++) {
+        circuits.push_back(make_unique<Circuit>());
+        buildCircuit(FAMILY_GRID_2D, 5000, 3, *circuits.back());
+        circuits.back()->setBackend(BACKEND_SPARSE_DIRECT);
+        circuits.back()->setFactorCacheDirectory(dir.string());
+        circuits.back()->setResultCacheDirectory(dir.string());
+    }
+    for (int w = 0; w < WRITERS; w++) {
+        writers.emplace_back([&, w]() { statuses[w] = circuits[w]->solve(); });
+    }
+    for (auto& t : writers) t.join();
+
+    double worst = 0;
+    for (int w = 0; w < WRITERS; w++) {
+        if (!statuses[w]) failures++;
+        else worst = max(worst, largestDifference(*circuits[0], *circuits[w]));
+    }
+    if (worst > 1e-9) failures++;
+    int files = 0, leftovers = 0;
+    for (const auto& entry : filesystem::directory_iterator(dir)) {
+        files++;
+        if (entry.path().extension() == ".partial") leftovers++;
+    }
+    if (files != 2 || leftovers != 0) failures++;
+    filesystem::remove_all(dir);
+    cout << "shared caches: " << WRITERS << " writer(s), " << files << " file(s), " << leftovers
+         << " temporary file(s) left, difference " << worst << " V, " << failures << " failure(s)\n";
+    return failures;
+}
+
+
+int main() {
+    int failures = 0;
+    failures += checkSnapshotReaders();
+    failures += checkForkedVariants();
+    failures += checkAsyncSolves();
+    failures += checkScheduler();
+    failures += checkDefaultQuotas();
+    failures += checkSharedCaches();
+    return failures == 0 ? 0 : 1;
+}
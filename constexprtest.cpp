@@ -0,0 +1,152 @@
+#include <iostream>
+#include <string>
+#include <cmath>
+#include "CircuitSolver.h"
+#include "StaticCircuit.h"
+using namespace std;
+
+// Compile-time solving with StaticCircuit: a few fixed reference networks
+// are solved in constant expressions (some values pinned by static_assert),
+// then rebuilt as run-time Circuits and solved by every backend. The dense
+// backend runs the same elimination, so it must match exactly; the others
+// within 1e-9 V.
+// Exit codes: 0 all networks match, 1 otherwise.
+
+
+// 1. Reference Networks
+
+
+constexpr auto DIVIDER = StaticCircuit<2, 3>()
+    .addVoltageSource("V1", "in", "GND", 5.0)
+    .addResistor("R1", "in", "out", 1000.0)
+    .addResistor("R2", "out", "GND", 1000.0);
+
+// 4-tap R-2R ladder: every tap sees R to ground, so each halves the voltage
+// of the one before it (8 V at the reference, 0.5 V at b0)
+constexpr auto R2R_LADDER = StaticCircuit<5, 10>()
+    .addVoltageSource("Vref", "ref", "GND", 8.0)
+    .addResistor("R1", "ref", "b3", 10e3)
+    .addResistor("R2", "b3", "b2", 10e3)
+    .addResistor("R3", "b2", "b1", 10e3)
+    .addResistor("R4", "b1", "b0", 10e3)
+    .addResistor("R5", "b0", "GND", 20e3)
+    .addResistor("R6", "b3", "GND", 20e3)
+    .addResistor("R7", "b2", "GND", 20e3)
+    .addResistor("R8", "b1", "GND", 20e3)
+    .addResistor("R9", "b0", "GND", 20e3);
+
+// Unbalanced Wheatstone bridge fed by a current source
+constexpr auto BRIDGE = StaticCircuit<4, 7>()
+    .addCurrentSource("I1", "GND", "top", 2e-3)
+    .addResistor("Ra", "top", "left", 1.2e3)
+    .addResistor("Rb", "top", "right", 3.3e3)
+    .addResistor("Rc", "left", "GND", 4.7e3)
+    .addResistor("Rd", "right", "GND", 1.5e3)
+    .addResistor("Rm", "left", "right", 10e3)
+    .addResistor("Rload", "top", "GND", 22e3);
+
+// Stacked and floating voltage sources (a reference and its offset rails)
+constexpr auto RAILS = StaticCircuit<5, 8>()
+    .addVoltageSource("Vbat", "bat", "0", 12.0)
+    .addVoltageSource("Vdrop", "bat", "rail", 0.7)
+    .addVoltageSource("Vref", "ref", "mid", 2.5)
+    .addResistor("R1", "rail", "mid", 4.7e3)
+    .addResistor("R2", "mid", "gnd", 4.7e3)
+    .addResistor("R3", "ref", "out", 1e3)
+    .addResistor("R4", "out", "GND", 3e3)
+    .addCurrentSource("Ileak", "out", "GND", 1e-4);
+
+constexpr auto DIVIDER_VOLTAGES = DIVIDER.solve();
+constexpr auto R2R_VOLTAGES = R2R_LADDER.solve();
+constexpr auto BRIDGE_VOLTAGES = BRIDGE.solve();
+constexpr auto RAILS_VOLTAGES = RAILS.solve();
+
+static_assert(DIVIDER_VOLTAGES[DIVIDER.getNodeID("out")] == 2.5, "divider midpoint");
+static_assert(constexprAbs(R2R_VOLTAGES[R2R_LADDER.getNodeID("b0")] - 0.5) < 1e-12, "R-2R ladder tap");
+static_assert(constexprAbs(RAILS_VOLTAGES[RAILS.getNodeID("rail")] - 11.3) < 1e-12, "floating source offset");
+static_assert(DIVIDER_VOLTAGES.size() == 3 && DIVIDER.getNodeCount() == 2, "voltages by node ID");
+
+
+// 2. Checks Against the Run-time Solver
+
+
+template<size_t MaxNodes, size_t MaxComponents>
+int checkNetwork(const string& name, const StaticCircuit<MaxNodes, MaxComponents>& network,
+                 const array<double, MaxNodes + 1>& voltages) {
+    int failures = 0;
+    double worst = 0;
+    for (SolverBackend backend : {BACKEND_DENSE, BACKEND_SPARSE_DIRECT, BACKEND_ITERATIVE}) {
+        Circuit c;
+        network.addTo(c);
+        c.setBackend(backend);
+        Status status = c.solve();
+        if (!status || c.getNodeCount() != (int)network.getNodeCount()) {
+            cout << "  " << name << ": " << backendName(backend) << " failed: " << status.error << "\n";
+            failures++;
+            continue;
+        }
+        for (int id = 0; id <= c.getNodeCount(); id++) {
+            double runtime = c.getNodeVoltages().at(id);
+            double error = fabs(runtime - voltages[id]);
+            if (backend == BACKEND_DENSE ? runtime != voltages[id] : error > 1e-9) failures++;
+            worst = max(worst, error);
+        }
+    }
+    cout << name << ": " << network.getNodeCount() << " node(s), worst difference " << worst
+         << (failures ? " FAILED" : "") << "\n";
+    return failures;
+}
+
+// Solved at run time instead, a singular network throws like Circuit::solve()
+// reports it (in a constant expression it is a compile error)
+int checkSingular() {
+    auto floating = StaticCircuit<3, 2>()
+        .addVoltageSource("V1", "a", "GND", 1.0)
+        .addResistor("R1", "b", "c", 100.0);
+    try {
+        floating.solve();
+    } catch (const runtime_error& e) {
+        bool ok = string(e.what()) == SINGULAR_MESSAGE;
+        cout << "singular network: " << (ok ? "rejected" : "wrong error FAILED") << "\n";
+        return ok ? 0 : 1;
+    }
+    cout << "singular network: solved FAILED\n";
+    return 1;
+}
+
+// Like Circuit, a component across a single node (ground aliases included)
+// is rejected, and a rejected component creates no nodes
+int checkRejectedComponents() {
+    StaticCircuit<2, 2> circuit;
+    int rejected = 0;
+    try {
+        circuit.addVoltageSource("V1", "a", "a", 1.0);
+    } catch (const invalid_argument&) {
+        rejected++;
+    }
+    try {
+        circuit.addResistor("R1", "GND", "0", 100.0);
+    } catch (const invalid_argument&) {
+        rejected++;
+    }
+    try {
+        circuit.addResistor("R2", "b", "", 100.0);
+    } catch (const invalid_argument&) {
+        rejected++;
+    }
+    bool ok = rejected == 3 && circuit.getNodeCount() == 0 && circuit.getComponentCount() == 0;
+    cout << "rejected components: " << rejected << " of 3, " << circuit.getNodeCount() << " node(s) left"
+         << (ok ? "" : " FAILED") << "\n";
+    return ok ? 0 : 1;
+}
+
+int main() {
+    int failures = 0;
+    failures += checkNetwork("divider", DIVIDER, DIVIDER_VOLTAGES);
+    failures += checkNetwork("R-2R ladder", R2R_LADDER, R2R_VOLTAGES);
+    failures += checkNetwork("bridge", BRIDGE, BRIDGE_VOLTAGES);
+    failures += checkNetwork("rails", RAILS, RAILS_VOLTAGES);
+    failures += checkSingular();
+    failures += checkRejectedComponents();
+    return failures == 0 ? 0 : 1;
+}
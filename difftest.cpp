@@ -0,0 +1,487 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <random>
+#include <cmath>
+#include <chrono>
+#include <algorithm>
+#include <functional>
+#include <filesystem>
+#include "CircuitSolver.h"
+#include "CircuitGenerators.h"
+#include "PreparedSolve.h"
+#include "SolveScheduler.h"
+#include "CodeGenerator.h"
+#include "ResultCache.h"
+using namespace std;
+
+// Differential testing harness: random circuits from every generator family
+// (with resistances spread over several decades) are solved by every solver
+// path and compared with a long double MNA reference. A failing netlist is
+// shrunk by delta debugging while it keeps failing the same way, and the
+// minimal circuit is written with Circuit::saveCircuit() as a reproducer
+// that `main` can load directly.
+// Exit codes: 0 all paths agree, 1 mismatches found, 2 usage error.
+
+
+// 1. Netlists
+
+
+struct ComponentSpec {
+    ComponentType type;
+    string name, nodeA, nodeB;
+    double value;
+};
+typedef vector<ComponentSpec> Netlist;
+
+Netlist extractNetlist(const Circuit& c) {
+    vector<string> idName(c.getNodeCount() + 1);
+    for (const auto& entry : c.getNodeMap()) idName[entry.second] = entry.first;
+    idName[0] = "GND";
+    Netlist net;
+    for (const auto& comp : c.getComponents()) {
+        net.push_back({comp->getType(), comp->name, idName[comp->nodeA_ID], idName[comp->nodeB_ID], comp->value});
+    }
+    return net;
+}
+
+void buildFromNetlist(const Netlist& net, Circuit& c) {
+    for (const ComponentSpec& s : net) {
+        if (s.type == RESISTOR) c.addResistor(s.name, s.nodeA, s.nodeB, s.value);
+        else if (s.type == CURRENT_SOURCE) c.addCurrentSource(s.name, s.nodeA, s.nodeB, s.value);
+        else c.addVoltageSource(s.name, s.nodeA, s.nodeB, s.value);
+    }
+}
+
+
+// 2. High-precision Reference
+
+
+// Gaussian elimination with partial pivoting in long double on the dense
+// MNA system. Returns false when the circuit is singular (floating nodes,
+// voltage-source loops), which the minimizer uses to reject candidates.
+bool referenceSolve(const Netlist& net, vector<long double>& voltages) {
+    Circuit c;
+    buildFromNetlist(net, c);
+    int nodes = c.getNodeCount();
+    if (nodes == 0) return false;
+    bool grounded = false;
+    for (const auto& comp : c.getComponents()) grounded = grounded || comp->nodeA_ID == 0 || comp->nodeB_ID == 0;
+    if (!grounded) return false;
+
+    vector<vector<double>> Ad;
+    vector<double> Bd;
+    assembleMNA(c, Ad, Bd);
+    int n = (int)Bd.size();
+    vector<vector<long double>> A(n, vector<long double>(n));
+    vector<long double> B(Bd.begin(), Bd.end());
+    long double scale = 0;
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            A[i][j] = Ad[i][j];
+            scale = max(scale, fabsl(A[i][j]));
+        }
+    }
+
+    for (int k = 0; k < n; k++) {
+        int pivot = k;
+        for (int i = k + 1; i < n; i++) if (fabsl(A[i][k]) > fabsl(A[pivot][k])) pivot = i;
+        if (fabsl(A[pivot][k]) <= 1e-13L * scale) return false;
+        swap(A[k], A[pivot]);
+        swap(B[k], B[pivot]);
+        for (int i = k + 1; i < n; i++) {
+            long double f = A[i][k] / A[k][k];
+            if (f == 0) continue;
+            for (int j = k; j < n; j++) A[i][j] -= f * A[k][j];
+            B[i] -= f * B[k];
+        }
+    }
+    vector<long double> x(n);
+    for (int i = n - 1; i >= 0; i--) {
+        long double sum = B[i];
+        for (int j = i + 1; j < n; j++) sum -= A[i][j] * x[j];
+        x[i] = sum / A[i][i];
+    }
+    voltages.assign(nodes + 1, 0.0L);
+    for (int i = 0; i < nodes; i++) voltages[i + 1] = x[i];
+    return true;
+}
+
+
+// 3. Solver Paths
+
+
+// One way of solving a circuit through the public API. Each run gets a
+// freshly built circuit; a failed Status (or an exception) is a failure,
+// reported as "[SOLVER ERROR]: <message>". Iterative paths stop
+// at a relative residual of 1e-10, so their voltage error grows with the
+// condition number (trees with widely spread resistances reach ~1e-6).
+struct SolverPath {
+    string name;
+    double tolerance; // Max error relative to max(1 V, largest |voltage|)
+    function<Status(Circuit&)> run;
+};
+
+// Prepared re-solve: solve, move every value, solve, restore, solve again.
+// Exercises the restamping (offsets included) and the factor reuse.
+Status preparedResolve(Circuit& c) {
+    PreparedSolve prepared(c);
+    prepared.solve();
+    int count = prepared.componentCount();
+    vector<double> original(count);
+    for (int k = 0; k < count; k++) {
+        original[k] = prepared.getValue(k);
+        prepared.setValue(k, original[k] * (1.5 + 0.25 * (k % 3)));
+    }
+    prepared.solve();
+    for (int k = 0; k < count; k++) prepared.setValue(k, original[k]);
+    prepared.solve();
+    prepared.applyTo(c);
+    return Status();
+}
+
+// Batched solve: the case is instance 9 of 11 (the second block), the
+// other instances have every value scaled, so a lane mix-up shows up
+Status batchedSolve(Circuit& c) {
+    const int INSTANCES = 11, CASE = 9;
+    BatchSolve batch(c, INSTANCES);
+    for (int i = 0; i < INSTANCES; i++) {
+        if (i == CASE) continue;
+        for (int k = 0; k < batch.componentCount(); k++) {
+            batch.setValue(i, k, batch.getValue(i, k) * (1.25 + 0.125 * ((i + k) % 5)));
+        }
+    }
+    batch.solve();
+    batch.applyTo(CASE, c);
+    return Status();
+}
+
+// Sparse factorization run as a scheduler job, so its subtrees are
+// factorized by parallel tasks and the top of the tree picks their updates up
+Status scheduledSparse(Circuit& c) {
+    static SolveScheduler scheduler(3);
+    c.setBackend(BACKEND_SPARSE_DIRECT);
+    return scheduler.submit(c).get();
+}
+
+// Generated straight-line solver, re-solved with moved values and then the
+// original ones. Without a working compiler it falls back to PreparedSolve
+// and still passes, so the first fallback is reported on stderr.
+Status generatedSolve(Circuit& c) {
+    GeneratedSolver generated(c);
+    static bool reported = false;
+    if (!generated.usesGeneratedCode() && !reported) {
+        cerr << "generated: falling back to PreparedSolve (" << generated.fallbackReason() << ")\n";
+        reported = true;
+    }
+    int count = generated.componentCount();
+    vector<double> original(count);
+    for (int k = 0; k < count; k++) {
+        original[k] = generated.getValue(k);
+        generated.setValue(k, original[k] * (1.5 + 0.25 * (k % 3)));
+    }
+    generated.solve();
+    for (int k = 0; k < count; k++) generated.setValue(k, original[k]);
+    generated.solve();
+    generated.applyTo(c);
+    return Status();
+}
+
+// Persistent factor cache: an earlier "run" loads the saved circuit and
+// solves it into an empty cache directory, then this circuit must map that
+// factor file instead of factorizing
+Status factorCacheSolve(Circuit& c) {
+    filesystem::path dir = filesystem::temp_directory_path() / "difftest-factor-cache";
+    filesystem::remove_all(dir);
+    filesystem::create_directories(dir);
+    string netlist = (dir / "netlist.txt").string();
+    Status status = c.saveCircuit(netlist);
+    Circuit earlier;
+    if (status) status = earlier.loadCircuit(netlist);
+    if (status) {
+        earlier.setBackend(BACKEND_SPARSE_DIRECT);
+        earlier.setFactorCacheDirectory(dir.string());
+        status = earlier.solve();
+    }
+    if (status) {
+        bool mapped = false;
+        c.setLogger([&mapped](LogLevel, const string& message) {
+            if (message.rfind("Mapped cached factor", 0) == 0) mapped = true;
+        });
+        c.setBackend(BACKEND_SPARSE_DIRECT);
+        c.setFactorCacheDirectory(dir.string());
+        status = c.solve();
+        if (status && !mapped) status = Status::failure("factor file was not reused");
+    }
+    filesystem::remove_all(dir);
+    return status;
+}
+
+// Result cache: the same circuit with its components shuffled, resistors
+// turned around and every node and component renamed is solved into an
+// empty cache directory, then this circuit must be answered from the cache
+// (unless its canonical form is not exact, where a miss is allowed)
+Status resultCacheSolve(Circuit& c) {
+    filesystem::path dir = filesystem::temp_directory_path() / "difftest-result-cache";
+    filesystem::remove_all(dir);
+    filesystem::create_directories(dir);
+    Netlist net = extractNetlist(c);
+    mt19937_64 rng(net.size());
+    shuffle(net.begin(), net.end(), rng);
+    auto rename = [](const string& node) { return node == "GND" ? node : "renamed_" + node; };
+    for (size_t k = 0; k < net.size(); k++) {
+        ComponentSpec& s = net[k];
+        s.name = "X" + to_string(k);
+        s.nodeA = rename(s.nodeA);
+        s.nodeB = rename(s.nodeB);
+        if (s.type == RESISTOR && rng() % 2) swap(s.nodeA, s.nodeB);
+    }
+    Circuit earlier;
+    Status status;
+    try {
+        buildFromNetlist(net, earlier);
+    } catch (const exception& e) {
+        status = Status::failure(e.what());
+    }
+    if (status) {
+        earlier.setResultCacheDirectory(dir.string());
+        status = earlier.solve();
+    }
+    if (status) {
+        bool cached = false;
+        c.setLogger([&cached](LogLevel, const string& message) {
+            if (message.rfind("Results from cache", 0) == 0) cached = true;
+        });
+        c.setResultCacheDirectory(dir.string());
+        status = c.solve();
+        if (status && !cached && canonicalizeCircuit(c).exact) status = Status::failure("cached result was not found");
+        if (status && cached && c.getLastBackend() != BACKEND_CACHED) status = Status::failure("cache hit reported another backend");
+    }
+    filesystem::remove_all(dir);
+    return status;
+}
+
+vector<SolverPath> solverPaths() {
+    auto backend = [](SolverBackend b) {
+        return [b](Circuit& c) { c.setBackend(b); return c.solve(); };
+    };
+    return {
+        {"dense", 1e-9, backend(BACKEND_DENSE)},
+        {"sparse", 1e-9, backend(BACKEND_SPARSE_DIRECT)},
+        {"iterative", 1e-5, backend(BACKEND_ITERATIVE)},
+        {"out-of-core", 1e-9, backend(BACKEND_OUT_OF_CORE)},
+        {"planner", 1e-5, [](Circuit& c) { c.setMaxMemory(64 << 10); return c.solve(); }},
+        {"deadline", 1e-5, [](Circuit& c) {
+            Status status = c.solve(chrono::milliseconds(1)).status;
+            c.waitForRefinement();
+            return status;
+        }},
+        {"progressive", 1e-5, [](Circuit& c) { return c.solveProgressive(); }},
+        {"prepared", 1e-9, preparedResolve},
+        {"batched", 1e-9, batchedSolve},
+        {"scheduled", 1e-9, scheduledSparse},
+        {"generated", 1e-9, generatedSolve},
+        {"factor-cache", 1e-9, factorCacheSolve},
+        {"result-cache", 1e-9, resultCacheSolve},
+    };
+}
+
+struct PathOutcome {
+    bool failed = false;
+    string reason;
+    double error = 0; // Relative max-norm error against the reference
+};
+
+bool injectFault = false; // --inject-fault: corrupt "sparse" when a voltage source is present
+
+PathOutcome runPath(const SolverPath& path, const Netlist& net, const vector<long double>& reference) {
+    PathOutcome outcome;
+    Circuit c;
+    buildFromNetlist(net, c);
+
+    Status status;
+    try {
+        status = path.run(c);
+    } catch (const exception& e) {
+        status = Status::failure(e.what());
+    }
+    if (!status) {
+        outcome.failed = true;
+        outcome.reason = "[SOLVER ERROR]: " + status.error;
+        return outcome;
+    }
+
+    const auto& voltages = c.getNodeVoltages();
+    long double scale = 1.0L;
+    for (long double v : reference) scale = max(scale, fabsl(v));
+    bool hasSource = false;
+    for (const ComponentSpec& s : net) hasSource = hasSource || s.type == VOLTAGE_SOURCE;
+    for (int id = 1; id < (int)reference.size(); id++) {
+        auto it = voltages.find(id);
+        if (it == voltages.end() || !isfinite(it->second)) {
+            outcome.failed = true;
+            outcome.reason = "no finite voltage for node ID " + to_string(id);
+            return outcome;
+        }
+        double v = it->second;
+        if (injectFault && path.name == "sparse" && hasSource && id == 1) v += 1e-3;
+        outcome.error = max(outcome.error, (double)(fabsl(v - reference[id]) / scale));
+    }
+    if (outcome.error > path.tolerance) {
+        ostringstream reason;
+        reason << "max relative error " << scientific << setprecision(2) << outcome.error
+               << " > tolerance " << path.tolerance;
+        outcome.failed = true;
+        outcome.reason = reason.str();
+    }
+    return outcome;
+}
+
+
+// 4. Minimization (delta debugging over the component list)
+
+
+// Still a valid circuit (reference solvable) that still fails this path
+bool stillFails(const SolverPath& path, const Netlist& net) {
+    vector<long double> reference;
+    if (!referenceSolve(net, reference)) return false;
+    return runPath(path, net, reference).failed;
+}
+
+Netlist minimize(const SolverPath& path, Netlist net) {
+    size_t chunks = 2;
+    while (net.size() >= 2) {
+        size_t chunk = (net.size() + chunks - 1) / chunks;
+        bool reduced = false;
+        for (size_t start = 0; start < net.size(); start += chunk) {
+            Netlist candidate;
+            candidate.reserve(net.size());
+            candidate.insert(candidate.end(), net.begin(), net.begin() + start);
+            candidate.insert(candidate.end(), net.begin() + min(net.size(), start + chunk), net.end());
+            if (!candidate.empty() && stillFails(path, candidate)) {
+                net = move(candidate);
+                chunks = max<size_t>(chunks - 1, 2);
+                reduced = true;
+                break;
+            }
+        }
+        if (reduced) continue;
+        if (chunk == 1) break; // 1-minimal: no single component can go
+        chunks = min(net.size(), chunks * 2);
+    }
+    return net;
+}
+
+
+// 5. Command Line
+
+
+struct DiffOptions {
+    int cases = 100;
+    long long maxNodes = 120;
+    unsigned seed = 1;
+    double spread = 2.0; // Resistances are scaled by 10^U(-spread, spread)
+    vector<CircuitFamily> families = allFamilies();
+    string outDir = "difftest-repros";
+};
+
+void printUsage(const char* program) {
+    cerr << "Usage: " << program << " [options]\n"
+         << "  --cases <n>            random circuits to test (default 100)\n"
+         << "  --max-nodes <n>        largest circuit (default 120; the reference is dense)\n"
+         << "  --seed <n>             seed of the whole run (default 1)\n"
+         << "  --spread <decades>     resistance spread, +-decades (default 2)\n"
+         << "  --families <a,b,..>    generator families (default: all)\n"
+         << "  --out <dir>            where minimized reproducers go (default difftest-repros)\n"
+         << "  --inject-fault         corrupt one path on purpose (checks the minimizer)\n";
+}
+
+int main(int argc, char* argv[]) {
+    DiffOptions opt;
+    try {
+        for (int i = 1; i < argc; i++) {
+            string arg = argv[i];
+            if (arg == "--inject-fault") { injectFault = true; continue; }
+            if (i + 1 >= argc) throw invalid_argument("Missing value for " + arg);
+            string value = argv[++i];
+            if (arg == "--cases") opt.cases = stoi(value);
+            else if (arg == "--max-nodes") opt.maxNodes = max(2LL, stoll(value));
+            else if (arg == "--seed") opt.seed = (unsigned)stoul(value);
+            else if (arg == "--spread") opt.spread = stod(value);
+            else if (arg == "--out") opt.outDir = value;
+            else if (arg == "--families") {
+                opt.families.clear();
+                stringstream list(value);
+                string name;
+                while (getline(list, name, ',')) {
+                    CircuitFamily f;
+                    if (!parseFamily(name, f)) throw invalid_argument("Unknown family '" + name + "'");
+                    opt.families.push_back(f);
+                }
+            } else {
+                throw invalid_argument("Unknown option " + arg);
+            }
+        }
+        if (opt.families.empty()) throw invalid_argument("No families selected");
+    } catch (const exception& e) {
+        cerr << "Error: " << e.what() << "\n";
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    vector<SolverPath> paths = solverPaths();
+    vector<double> worstError(paths.size(), 0.0);
+    mt19937_64 rng(opt.seed);
+    int failures = 0, skipped = 0;
+
+    for (int k = 0; k < opt.cases; k++) {
+        CircuitFamily family = opt.families[k % opt.families.size()];
+        long long nodes = 2 + (long long)(rng() % (unsigned long long)(opt.maxNodes - 1));
+        unsigned caseSeed = (unsigned)rng();
+
+        Circuit generated;
+        buildCircuit(family, nodes, caseSeed, generated);
+        Netlist net = extractNetlist(generated);
+        uniform_real_distribution<double> decades(-opt.spread, opt.spread);
+        for (ComponentSpec& s : net) if (s.type == RESISTOR) s.value *= pow(10.0, decades(rng));
+
+        vector<long double> reference;
+        if (!referenceSolve(net, reference)) {
+            cerr << "case " << k << " (" << familyName(family) << ", " << nodes << " nodes): reference singular, skipped\n";
+            skipped++;
+            continue;
+        }
+
+        for (size_t p = 0; p < paths.size(); p++) {
+            PathOutcome outcome = runPath(paths[p], net, reference);
+            worstError[p] = max(worstError[p], outcome.error);
+            if (!outcome.failed) continue;
+
+            failures++;
+            Netlist small = minimize(paths[p], net);
+            filesystem::create_directories(opt.outDir);
+            string file = (filesystem::path(opt.outDir) /
+                           ("difftest_" + paths[p].name + "_" + familyName(family) + "_" + to_string(caseSeed) + ".txt")).string();
+            Circuit repro;
+            buildFromNetlist(small, repro);
+            Status saved = repro.saveCircuit(file);
+            if (!saved) cerr << "Error: " << saved.error << "\n";
+            cout << "FAIL " << paths[p].name << " on case " << k << " (" << familyName(family) << ", "
+                 << net.size() << " components): " << outcome.reason << "\n"
+                 << "     minimized to " << small.size() << " component(s): " << file << "\n";
+        }
+    }
+
+    cout << "\n" << opt.cases << " case(s), " << skipped << " skipped, " << failures << " failure(s)\n";
+    cout << left << setw(14) << "path" << right << setw(14) << "worst error" << setw(14) << "tolerance" << "\n";
+    for (size_t p = 0; p < paths.size(); p++) {
+        cout << left << setw(14) << paths[p].name << right << scientific << setprecision(2)
+             << setw(14) << worstError[p] << setw(14) << paths[p].tolerance << defaultfloat << "\n";
+    }
+    return failures == 0 ? 0 : 1;
+}
+//cmake --build --preset release makes build/release/difftest
+// ./build/release/difftest --cases 1000 --max-nodes 300
@@ -1,9 +1,23 @@
 #include <iostream>
 #include <string>
 #include <limits>
+#include <fstream>
 #include "CircuitSolver.h"
+#include "CircuitAnalysis.h"
 using namespace std;
 
+// Menu option 4 shows results after at most this long
+const chrono::milliseconds SOLVE_DEADLINE(100);
+
+// Helper: dimension of the MNA system solve() would build
+int mnaSize(const Circuit& circuit) {
+    int size = circuit.getNodeCount();
+    for (const auto& comp : circuit.getComponents()) {
+        if (comp->getType() == VOLTAGE_SOURCE) size++;
+    }
+    return size;
+}
+
 // Helper to prevent crashes on invalid input
 double getValidDouble(const string& prompt) {
     double value;
@@ -19,6 +33,11 @@ double getValidDouble(const string& prompt) {
     }
 }
 
+// Helper: report a failed solve the way the CLI always has
+void reportSolve(const Status& status) {
+    if (!status) cerr << "\n[SOLVER ERROR]: " << status.error << "\n" << endl;
+}
+
 void printMenu() {
     cout << "\n========================================\n";
     cout << "   C++ CIRCUIT SOLVER (MNA Algorithm)   \n";
@@ -31,22 +50,76 @@ void printMenu() {
     cout << "6. Load Circuit (Auto-Solves)\n"; 
     cout << "7. Clear Circuit\n";
     cout << "8. Visualize Circuit (Text Graph)\n";
+    cout << "9. Analyze Circuit (Cost Prediction)\n";
+    cout << "10. Progressive Solve (Large Meshes)\n";
     cout << "0. Exit\n";
     cout << "========================================\n";
     cout << "Enter choice: ";
 }
 
-int main() {
+int main(int argc, char* argv[]) {
     Circuit circuit;
+    circuit.setLogger(consoleLogger()); // The library itself stays silent
     int choice;
     string name, n1, n2, filename;
     double value;
 
+    // Command line: --max-memory <size> caps the memory any solve may use,
+    // --scratch-dir <dir> is where out-of-core factors are spilled,
+    // --factor-cache <dir> keeps sparse factors there for later runs,
+    // --result-cache <dir> reuses voltages of circuits solved before, --stats
+    // prints per-phase timings as JSON (to stderr) after every solve and
+    // --perf adds hardware counters (cycles, IPC, cache and branch misses),
+    // --trace <file> writes a Chrome trace timeline of the session on exit,
+    // --memory adds heap per subsystem and peak RSS per phase to the stats
+    bool printStats = false;
+    bool usesCache = false;
+    string tracePath;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        size_t bytes;
+        if (arg == "--max-memory" && i + 1 < argc && parseByteSize(argv[i + 1], bytes)) {
+            circuit.setMaxMemory(bytes);
+            i++;
+        } else if (arg == "--scratch-dir" && i + 1 < argc) {
+            circuit.setScratchDirectory(argv[++i]);
+        } else if (arg == "--factor-cache" && i + 1 < argc) {
+            circuit.setFactorCacheDirectory(argv[++i]);
+            usesCache = true;
+        } else if (arg == "--result-cache" && i + 1 < argc) {
+            circuit.setResultCacheDirectory(argv[++i]);
+            usesCache = true;
+        } else if (arg == "--stats") {
+            printStats = true;
+            circuit.enableStats();
+        } else if (arg == "--trace" && i + 1 < argc) {
+            tracePath = argv[++i];
+            startTracing();
+            setTraceThreadName("main");
+        } else if (arg == "--memory") {
+            printStats = true;
+            circuit.enableMemoryTracking();
+        } else if (arg == "--perf") {
+            printStats = true;
+            if (!circuit.enableHardwareCounters()) {
+                cerr << "Hardware counters unavailable (" << circuit.getStats().countersReason
+                     << "); reporting timings only.\n";
+            }
+        } else {
+            cerr << "Usage: " << argv[0] << " [--max-memory <size, e.g. 512M or 4G>] [--scratch-dir <dir>] [--factor-cache <dir>] [--result-cache <dir>] [--stats] [--perf] [--memory] [--trace <file>]\n";
+            return 1;
+        }
+    }
+
     while (true) {
+        if (circuit.pollRefinement()) {
+            cout << "\nBackground refinement finished - results updated.\n";
+            circuit.displayResults();
+        }
         printMenu();
         
         if (!(cin >> choice)) {
-            cout << "Invalid input. Please enter a number (0-9).\n";
+            cout << "Invalid input. Please enter a number (0-10).\n";
             cin.clear();
             cin.ignore(numeric_limits<streamsize>::max(), '\n');
             continue;
@@ -82,22 +155,41 @@ int main() {
                 break;
 
             case 4:
-                circuit.solve();
+                // Small systems solve directly (dense or fixed-size) faster
+                // than any preview, and a memory budget or a cache needs the
+                // full solve(); otherwise show a preview within the deadline
+                // and let refinement finish in the background
+                if (mnaSize(circuit) <= DENSE_AUTO_LIMIT || circuit.getMaxMemory() > 0 || usesCache) {
+                    reportSolve(circuit.solve());
+                } else {
+                    ApproximateSolution preview = circuit.solve(SOLVE_DEADLINE);
+                    reportSolve(preview.status);
+                    if (circuit.isRefining()) {
+                        cout << "Preview after " << preview.iterations << " iterations (estimated error "
+                             << scientific << setprecision(2) << preview.errorEstimate << " V)"
+                             << defaultfloat << setprecision(6)
+                             << ". Refining in the background..." << endl;
+                    } else if (preview.converged) {
+                        cout << "Circuit Solved Successfully!" << endl;
+                    }
+                }
                 circuit.displayResults();
+                if (printStats) circuit.getStats().writeJson(cerr);
                 break;
 
             case 5:
                 cout << "Enter filename to save: "; cin >> filename;
-                circuit.saveCircuit(filename);
+                if (Status saved = circuit.saveCircuit(filename); !saved) cerr << "Error: " << saved.error << endl;
                 break;
 
             case 6: // UPDATED: Auto-Solve after loading
                 cout << "Enter filename to load: "; cin >> filename;
-                circuit.loadCircuit(filename);
+                if (Status loaded = circuit.loadCircuit(filename); !loaded) cerr << "Error: " << loaded.error << endl;
                 // Automatically solve and show results to the user
                 cout << "Auto-solving loaded circuit...\n";
-                circuit.solve();
+                reportSolve(circuit.solve());
                 circuit.displayResults();
+                if (printStats) circuit.getStats().writeJson(cerr);
                 break;
 
             case 7:
@@ -108,10 +200,27 @@ int main() {
             case 8:
                 circuit.visualizeCircuit();
                 break;
+
+            case 9:
+                printAnalysis(analyzeCircuit(circuit), cout);
+                break;
+
+            case 10:
+                reportSolve(circuit.solveProgressive([&circuit]() { circuit.displayResults(); }));
+                circuit.displayResults();
+                if (printStats) circuit.getStats().writeJson(cerr);
+                break;
             
 
             case 0:
                 cout << "Exiting.\n";
+                if (!tracePath.empty()) {
+                    circuit.waitForRefinement(); // So its task ends on the timeline
+                    stopTracing();
+                    ofstream traceFile(tracePath);
+                    if (traceFile) writeChromeTrace(traceFile);
+                    else cerr << "Error: Could not write " << tracePath << "\n";
+                }
                 return 0;
 
             default:
@@ -124,7 +233,7 @@ int main() {
     }
     return 0;
 }
-//g++ CircuitSolver.cpp  main.cpp -o main.exe makes a file
-// .\main.exe
+//cmake --preset release && cmake --build --preset release makes build/release/main (see CMakeLists.txt)
+// ./build/release/main
 // cd "DSA Project"
 // dir
\ No newline at end of file